@@ -0,0 +1,38 @@
+#version 330 core
+// variants: INSTANCED, MULTI_DRAW, see ShaderVariants
+layout (location = 0) in vec3 aPos;
+layout (location = 5) in vec4 aInstance; // block batch: xyz offset, w texture layer
+#ifdef MULTI_DRAW
+// RenderQueue's multi-draw: ObjectBlock per draw, picked by the command's base instance
+layout (location = 6) in mat4 aModel;
+#endif
+
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+    mat3 model_res;
+};
+
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    float far_plane;
+    float bakedLightScale;
+};
+
+// must land on exactly the depth objShader.vs produces, the main pass tests with GL_LEQUAL
+invariant gl_Position;
+
+void main()
+{
+    // same data flow as objShader.vs
+    vec3 FragPos;
+#ifdef INSTANCED
+    FragPos = aPos + aInstance.xyz;
+#elif defined(MULTI_DRAW)
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+#else
+    FragPos = vec3(model * vec4(aPos, 1.0));
+#endif
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
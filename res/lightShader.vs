@@ -1,9 +1,17 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+};
+
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    float far_plane;
+    float bakedLightScale;
+};
 
 void main()
 {
@@ -1,4 +1,5 @@
 #version 330 core
+// variants: TEXTURE_ARRAY, SHADOWS, PARABOLOID, GRID_SHADOW, LOCAL_LIGHTS, LIGHTMAP, see ShaderVariants
 out vec4 FragColor;
 
 struct Material {
@@ -19,24 +20,149 @@ struct Light {
     float quadratic;
 };
 
-#define NR_POINT_LIGHTS 1
-
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+flat in float Layer;
 
-uniform vec3 viewPos;
 uniform Material material;
-uniform Light lights[NR_POINT_LIGHTS];
 
-uniform float far_plane;
-uniform bool shadows;
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    float far_plane;
+    float bakedLightScale; // the torch flicker, shared by every light in the lightmap
+};
+
+layout (std140) uniform LightBlock {
+    mat4 shadowMatrices[6];
+    mat4 lightView; // light looking straight down, hemisphere along -z
+    vec4 lightPosition;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    vec4 lightAttenuation; // constant, linear, quadratic
+};
+
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray blockTextures;
+#endif
+
+#if defined(SHADOWS) && defined(GRID_SHADOW)
+uniform sampler2D shadowMask;   // the height below which each column is in the walls' shadow, see ShadowMask
+uniform vec4 shadowMaskArea;    // origin.x, origin.z, 1 / size.x, 1 / size.z
+#elif defined(SHADOWS) && defined(PARABOLOID)
+uniform sampler2D paraboloidMap;
+#elif defined(SHADOWS)
 uniform samplerCube depthMap;
+#endif
+
+#ifdef LIGHTMAP
+// ambient occlusion and the static lights baked per block face, see Lightmap
+flat in vec3 BlockCenter;
+uniform sampler2D lightmap;          // rgb static light, a ambient occlusion
+uniform usampler3D lightmapFaces;    // (cell.x * 6 + face, cell.y, cell.z) -> tile + 1
+uniform ivec3 lightmapOrigin;        // the cell at lightmapFaces' origin
+uniform ivec2 lightmapLayout;        // tiles per row, texels per tile side
+uniform int staticLights;            // the first lights of the grid, already in the lightmap
+#endif
+
+#ifdef LOCAL_LIGHTS
+// local point lights binned per maze cell on the CPU, see LightGrid
+uniform samplerBuffer lightData;     // (position, radius), (color, 0) per light
+uniform usamplerBuffer lightCells;   // (offset, count) per cell
+uniform usamplerBuffer lightIndices;
+uniform vec4 lightGrid;              // origin.x, origin.z, 1 / cell size
+uniform ivec2 lightGridSize;
+#endif
+
+Light getLight()
+{
+    // the shadow casting UAV light, straight out of the per-light block
+    return Light(lightPosition.xyz, lightAmbient.rgb, lightDiffuse.rgb, lightSpecular.rgb,
+                 lightAttenuation.x, lightAttenuation.y, lightAttenuation.z);
+}
+
+#ifdef LOCAL_LIGHTS
+// diffuse and specular of the local lights whose radius reaches this fragment's cell
+vec3 LocalLights(vec3 norm, vec3 viewDir, vec3 diffuseColor, vec3 specularColor)
+{
+    ivec2 cell = ivec2(floor((FragPos.xz - lightGrid.xy) * lightGrid.z));
+    if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, lightGridSize)))
+        return vec3(0.0);
+    uvec2 range = texelFetch(lightCells, cell.y * lightGridSize.x + cell.x).xy;
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < range.y; ++i) {
+        int light = int(texelFetch(lightIndices, int(range.x + i)).r);
+#ifdef LIGHTMAP
+        if (light < staticLights)
+            continue;
+#endif
+        vec4 positionRadius = texelFetch(lightData, light * 2);
+        vec3 color = texelFetch(lightData, light * 2 + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float distance = length(toLight);
+        if (distance >= positionRadius.w)
+            continue;
+        vec3 lightDir = toLight / distance;
+        // inverse square, windowed to reach zero at the radius
+        float window = clamp(1.0 - pow(distance / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+
+        float diff = max(dot(norm, lightDir), 0.0);
+        vec3 reflectDir = reflect(-lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+        result += color * (diff * diffuseColor + spec * specularColor) * attenuation;
+    }
+    return result;
+}
+#endif
+
+#ifdef LIGHTMAP
+// this fragment's texel of its block face's tile, no occlusion and no light where the face has none
+vec4 BakedLight()
+{
+    vec3 axes = abs(Normal);
+    int axis = axes.x > axes.y ? (axes.x > axes.z ? 0 : 2) : (axes.y > axes.z ? 1 : 2);
+    int face = axis * 2 + (Normal[axis] < 0.0 ? 1 : 0);
+    ivec3 cell = ivec3(round(BlockCenter * 0.5)) - lightmapOrigin;
+    ivec3 texel = ivec3(cell.x * 6 + face, cell.yz);
+    if (any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(texel, textureSize(lightmapFaces, 0))))
+        return vec4(0.0, 0.0, 0.0, 1.0);
+    int tile = int(texelFetch(lightmapFaces, texel, 0).r) - 1;
+    if (tile < 0)
+        return vec4(0.0, 0.0, 0.0, 1.0);
+
+    // the same face axes as the baker, clamped to the tile's texel centres so tiles never bleed
+    vec3 offset = FragPos - BlockCenter;
+    vec2 local = vec2(offset[(axis + 1) % 3], offset[(axis + 2) % 3]) * 0.5 + 0.5;
+    float side = float(lightmapLayout.y);
+    vec2 inTile = clamp(local * side, 0.5, side - 0.5);
+    vec2 corner = vec2(tile % lightmapLayout.x, tile / lightmapLayout.x) * side;
+    return texture(lightmap, (corner + inTile) / vec2(textureSize(lightmap, 0)));
+}
+#endif
 
+#if defined(SHADOWS) && defined(GRID_SHADOW)
+float GridShadowCalculation(vec3 fragPos, vec3 norm)
+{
+    // a little off the surface, so a wall face reads the column in front of it
+    vec3 p = fragPos + norm * 0.05;
+    vec2 uv = (p.xz - shadowMaskArea.xy) * shadowMaskArea.zw;
+    if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))))
+        return 0.0;
+    return p.y < texture(shadowMask, uv).r ? 1.0 : 0.0;
+}
+#endif
+
+#if defined(SHADOWS) && !defined(PARABOLOID) && !defined(GRID_SHADOW)
 float ShadowCalculation(vec3 fragPos)
 {
     // Get vector between fragment position and light position
-    vec3 fragToLight = fragPos - lights[0].position;
+    vec3 fragToLight = fragPos - lightPosition.xyz;
     // Use the fragment to light vector to sample from the depth map
     float closestDepth = texture(depthMap, fragToLight).r;
     // It is currently in linear range between [0,1]. Let's re-transform it back to original depth value
@@ -49,38 +175,79 @@ float ShadowCalculation(vec3 fragPos)
 
     return shadow;
 }
+#endif
+
+#if defined(SHADOWS) && defined(PARABOLOID)
+float ParaboloidShadowCalculation(vec3 fragPos)
+{
+    // Fragment position in the light's downward-looking space
+    vec3 p = vec3(lightView * vec4(fragPos, 1.0));
+    float currentDepth = length(p);
+    vec3 dir = p / currentDepth;
+    // Nothing above the light is ever in its shadow
+    if (dir.z > 0.0)
+        return 0.0;
+    // Same paraboloid mapping as the depth pass, from [-1,1] to texture space
+    vec2 uv = dir.xy / (1.0 - dir.z) * 0.5 + 0.5;
+    float closestDepth = texture(paraboloidMap, uv).r * far_plane;
+    float bias = 0.2;
+    return currentDepth - bias > closestDepth ? 1.0 : 0.0;
+}
+#endif
 
 void main()
 {
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
-
-    vec3 result = vec3(0, 0, 0);
-    for (int i = 0; i < NR_POINT_LIGHTS; ++i) {
-        Light light = lights[i];
-
-        // ambient
-        vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
-
-        // diffuse
-        vec3 lightDir = normalize(light.position - FragPos);
-        float diff = max(dot(norm, lightDir), 0.0);
-        vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
-
-        // specular
-        vec3 reflectDir = reflect(-lightDir, norm);
-        float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-        vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
-
-        float distance = length(light.position - FragPos);
-        float attenuation = 1.0 / (light.constant + light.linear * distance +
-            light.quadratic * (distance * distance));
-
-        float shadow = shadows ? ShadowCalculation(FragPos) : 0.0;
-
-        result += (ambient + (diffuse + specular) * (1.0 - shadow)) * attenuation;
-        // result += vec3(1.0);
-    }
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
+
+    // blocks read their layer of the shared array, and carry no specular map
+#ifdef TEXTURE_ARRAY
+    vec3 diffuseColor = texture(blockTextures, vec3(TexCoords, Layer)).rgb;
+    vec3 specularColor = vec3(0.0);
+#else
+    vec3 diffuseColor = texture(material.diffuse, TexCoords).rgb;
+    vec3 specularColor = texture(material.specular, TexCoords).rgb;
+#endif
+
+    Light light = getLight();
+
+    // ambient
+    vec3 ambient = light.ambient * diffuseColor;
+#ifdef LIGHTMAP
+    vec4 baked = BakedLight();
+    ambient *= baked.a;
+#endif
+
+    // diffuse
+    vec3 lightDir = normalize(light.position - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = light.diffuse * diff * diffuseColor;
+
+    // specular
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3 specular = light.specular * spec * specularColor;
+
+    float distance = length(light.position - FragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance +
+        light.quadratic * (distance * distance));
+
+    float shadow = 0.0;
+#if defined(SHADOWS) && defined(GRID_SHADOW)
+    shadow = GridShadowCalculation(FragPos, norm);
+#elif defined(SHADOWS) && defined(PARABOLOID)
+    shadow = ParaboloidShadowCalculation(FragPos);
+#elif defined(SHADOWS)
+    shadow = ShadowCalculation(FragPos);
+#endif
+
+    vec3 result = (ambient + (diffuse + specular) * (1.0 - shadow)) * attenuation;
+#ifdef LOCAL_LIGHTS
+    result += LocalLights(norm, viewDir, diffuseColor, specularColor);
+#endif
+#ifdef LIGHTMAP
+    result += baked.rgb * bakedLightScale * diffuseColor;
+#endif
 
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
@@ -1,21 +1,68 @@
 #version 330 core
+// variants: INSTANCED, LIGHTMAP (with INSTANCED), MULTI_DRAW, see ShaderVariants
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in vec4 aInstance; // block batch: xyz offset, w texture layer
+#ifdef MULTI_DRAW
+// RenderQueue's multi-draw: ObjectBlock per draw, picked by the command's base instance
+layout (location = 6) in mat4 aModel;
+layout (location = 10) in mat3 aModelRes;
+#endif
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+flat out float Layer;
+#ifdef LIGHTMAP
+flat out vec3 BlockCenter;
+#endif
 
-uniform mat4 model;
-uniform mat3 model_res;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+    mat3 model_res;
+};
+
+#ifdef INSTANCED
+// one texel per wall block, (row, layer, col) = position / 2; marked blocks show markLayer
+uniform usampler3D marks;
+uniform float markLayer;
+#endif
+
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    float far_plane;
+    float bakedLightScale;
+};
+
+// the depth pre-pass computes the same position, see depth_prepass.vs
+invariant gl_Position;
 
 void main()
 {
+#ifdef INSTANCED
+    // blocks are only ever translated, the normal needs no transform
+    FragPos = aPos + aInstance.xyz;
+    Normal = aNormal;
+    Layer = aInstance.w;
+#ifdef LIGHTMAP
+    BlockCenter = aInstance.xyz;
+#endif
+    ivec3 cell = ivec3(round(aInstance.xyz * 0.5));
+    if (all(greaterThanEqual(cell, ivec3(0))) && all(lessThan(cell, textureSize(marks, 0)))
+            && texelFetch(marks, cell, 0).r != 0u)
+        Layer = markLayer;
+#elif defined(MULTI_DRAW)
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+    Normal = aModelRes * aNormal;
+    Layer = 0.0;
+#else
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = model_res * aNormal;
+    Layer = 0.0;
+#endif
     TexCoords = aTexCoords;
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
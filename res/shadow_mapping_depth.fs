@@ -1,13 +1,28 @@
 #version 330 core
 in vec4 FragPos;
 
-uniform vec3 lightPos;
-uniform float far_plane;
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    float far_plane;
+    float bakedLightScale;
+};
+
+layout (std140) uniform LightBlock {
+    mat4 shadowMatrices[6];
+    mat4 lightView; // light looking straight down, hemisphere along -z
+    vec4 lightPosition;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    vec4 lightAttenuation; // constant, linear, quadratic
+};
 
 void main()
 {
     // get distance between fragment and light source
-    float lightDistance = length(FragPos.xyz - lightPos);
+    float lightDistance = length(FragPos.xyz - lightPosition.xyz);
 
     // map to [0;1] range by dividing by far_plane
     lightDistance = lightDistance / far_plane;
@@ -2,7 +2,15 @@
 layout (triangles) in;
 layout (triangle_strip, max_vertices=18) out;
 
-uniform mat4 shadowMatrices[6];
+layout (std140) uniform LightBlock {
+    mat4 shadowMatrices[6];
+    mat4 lightView; // light looking straight down, hemisphere along -z
+    vec4 lightPosition;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    vec4 lightAttenuation; // constant, linear, quadratic
+};
 
 out vec4 FragPos; // FragPos from GS (output per emitvertex)
 
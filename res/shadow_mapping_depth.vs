@@ -1,9 +1,23 @@
 #version 330 core
+// variants: INSTANCED, MULTI_DRAW, see ShaderVariants
 layout (location = 0) in vec3 position;
+layout (location = 5) in vec4 aInstance; // block batch: xyz offset, w texture layer
+#ifdef MULTI_DRAW
+// RenderQueue's multi-draw: ObjectBlock per draw, picked by the command's base instance
+layout (location = 6) in mat4 aModel;
+#endif
 
-uniform mat4 model;
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+};
 
 void main()
 {
+#ifdef INSTANCED
+    gl_Position = vec4(position + aInstance.xyz, 1.0);
+#elif defined(MULTI_DRAW)
+    gl_Position = aModel * vec4(position, 1.0);
+#else
     gl_Position = model * vec4(position, 1.0);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 330 core
+in float LightDistance;
+in float Hemisphere;
+
+layout (std140) uniform FrameBlock {
+    mat4 projection;
+    mat4 view;
+    vec4 viewPos;
+    float far_plane;
+    float bakedLightScale;
+};
+
+void main()
+{
+    if (Hemisphere < 0.0)
+        discard;
+
+    // same linear [0;1] distance encoding as the cubemap pass
+    gl_FragDepth = LightDistance / far_plane;
+}
@@ -0,0 +1,43 @@
+#version 330 core
+// variants: INSTANCED, MULTI_DRAW, see ShaderVariants
+layout (location = 0) in vec3 position;
+layout (location = 5) in vec4 aInstance; // block batch: xyz offset, w texture layer
+#ifdef MULTI_DRAW
+// RenderQueue's multi-draw: ObjectBlock per draw, picked by the command's base instance
+layout (location = 6) in mat4 aModel;
+#endif
+
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+};
+
+layout (std140) uniform LightBlock {
+    mat4 shadowMatrices[6];
+    mat4 lightView; // light looking straight down, hemisphere along -z
+    vec4 lightPosition;
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    vec4 lightAttenuation; // constant, linear, quadratic
+};
+
+out float LightDistance;
+out float Hemisphere;
+
+void main()
+{
+#ifdef INSTANCED
+    vec4 world = vec4(position + aInstance.xyz, 1.0);
+#elif defined(MULTI_DRAW)
+    vec4 world = aModel * vec4(position, 1.0);
+#else
+    vec4 world = model * vec4(position, 1.0);
+#endif
+    vec3 p = vec3(lightView * world);
+    LightDistance = length(p);
+    vec3 dir = p / LightDistance;
+    // > 0 for everything below the light, which is the only half we keep
+    Hemisphere = -dir.z;
+    // paraboloid projection of the lower hemisphere onto the unit disc
+    gl_Position = vec4(dir.xy / (1.0 - dir.z), 0.0, 1.0);
+}
@@ -1,12 +1,20 @@
 #version 330 core
 in vec2 TexCoords;
+in vec3 TextColor;
+flat in float Page;
 out vec4 color;
 
-uniform sampler2D text;
-uniform vec3 textColor;
+uniform sampler2DArray text;
+uniform bool sdf;
 
 void main()
 {
-    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-    color = vec4(textColor, 1.0) * sampled;
+    float sampled = texture(text, vec3(TexCoords, Page)).r;
+    float alpha = sampled;
+    if (sdf) {
+        // the outline sits at 0.5, blend over about one screen pixel at any scale
+        float width = max(fwidth(sampled) * 0.7, 0.001);
+        alpha = smoothstep(0.5 - width, 0.5 + width, sampled);
+    }
+    color = vec4(TextColor, alpha);
 }
\ No newline at end of file
@@ -4,10 +4,20 @@
 
 #include "Application.h"
 
-static string model_list[] = {"stone", "dirt", "bedrock"};
+// the first layers of the block texture array, everything else in the folder follows
+static vector<string> block_textures = {"stone", "dirt", "bedrock"};
+// occasional wall variety, all drawn from the same texture array at no extra cost
+static string wall_variants[] = {"cobblestone_mossy", "stonebrick_mossy", "stonebrick_cracked"};
 static string gamestates[] = {"free", "start", "finish"};
+static string shadowModeNames[] = {"cube", "parab", "grid"};
+static GLuint paraboloidResolutions[] = {256, 512, 1024, 2048};
 static float font_size = 48;
 
+// brightness of a torch over time, phase keeps neighbouring torches apart
+static float torchFlicker(float now, float phase) {
+    return 0.85f + 0.1f * std::sin(now * 9.0f + phase) + 0.05f * std::sin(now * 23.0f + phase * 3.0f);
+}
+
 Application::Application(const char *title, int width, int height, int map_size, int maze_length, int maze_width,
                          bool debug) {
 
@@ -20,6 +30,12 @@ Application::Application(const char *title, int width, int height, int map_size,
         monitor = nullptr;
     }
     GLFWwindow *window = glfwCreateWindow(width, height, title, monitor, nullptr);
+    if (window == nullptr) {
+        // no 4.6 driver, everything past 3.3 is optional
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(width, height, title, monitor, nullptr);
+    }
 
     if (window == nullptr) {
         std::cerr << "Failed to create GLFW window" << std::endl;
@@ -40,6 +56,13 @@ Application::Application(const char *title, int width, int height, int map_size,
         std::cerr << "Failed to initialize GLAD" << std::endl;
         exit(-1);
     }
+    loadGLExtensions((GLADloadproc) glfwGetProcAddress);
+    // every program below, the text shader included, comes from the binary cache when it can
+    auto startupStart = glfwGetTime();
+    if (ProgramCache::supported()) {
+        programCache = new ProgramCache("cache/programs");
+        Shader::programStore = programCache;
+    }
 
     // configure global openGL state
     glEnable(GL_DEPTH_TEST);
@@ -55,7 +78,26 @@ Application::Application(const char *title, int width, int height, int map_size,
     deltaTime = 0.f;
     lastFrame = 0.f;
 
+    shadowTimers[0] = new GpuTimer();
+    shadowTimers[1] = new GpuTimer();
+    sceneTimer = new GpuTimer();
+    stream = new StreamBuffer(STREAM_FRAME_SIZE);
+    threadPool = new ThreadPool();
+    capture = new FrameCapture();
+    renderQueue = new RenderQueue(stream);
+
     init(map_size, maze_length, maze_width);
+
+    if (debug) {
+        std::cout << "Startup " << (glfwGetTime() - startupStart) * 1000.0 << " ms";
+        if (programCache) {
+            std::cout << ", program cache " << programCache->hits() << " hits " << programCache->misses()
+                      << " misses, saved " << programCache->savedMilliseconds() << " ms";
+        } else {
+            std::cout << ", no program binary support";
+        }
+        std::cout << std::endl;
+    }
 }
 
 void Application::init(int map_size, int maze_length, int maze_width) {
@@ -82,24 +124,70 @@ void Application::init(int map_size, int maze_length, int maze_width) {
             false
     );
     camera = &camera_adventurer;
-    characterBallAdv = new Model("res/ball/ball.obj");
-    characterBallUav = new Model("res/UFO/UFO.obj");
-
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_BLEND);
+    // the previous level's models give their arena ranges back before the new ones take theirs
+    delete characterBallAdv;
+    delete characterBallUav;
+    delete collection;
+    characterBallAdv = new Model("res/ball/ball.obj", false, VertexFormat::COMPACT, 4);
+    characterBallUav = new Model("res/UFO/UFO.obj", false, VertexFormat::COMPACT, 4);
+
+    // only the HUD blends, the render graph enables it for that pass alone
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    freeType = new FreeType("res/assets/fonts/minecrafter/Minecrafter.Reg.ttf");
-//    ourShader = new Shader("res/shader.vs", "res/shader.fs");
-    lightCubeShader = new Shader("res/lightShader.vs", "res/lightShader.fs");
-    objShader = new Shader("res/objShader.vs", "res/objShader.fs");
-    depthShader = new Shader("res/shadow_mapping_depth.vs", "res/shadow_mapping_depth.fs",
-                             "res/shadow_mapping_depth.gs");
+    // the font and the HUD built on it outlive every level
+    if (!freeType) {
+        freeType = new FreeType("res/assets/fonts/minecrafter/Minecrafter.Reg.ttf", stream);
+        initHud();
+    }
+    // programs do not depend on the level, a restart keeps them
+    if (!objShaders) {
+//        ourShader = new Shader("res/shader.vs", "res/shader.fs");
+        auto bindBlocks = [](Shader &shader) {
+            shader.bindUniformBlock("FrameBlock", FRAME_BLOCK_BINDING);
+            shader.bindUniformBlock("LightBlock", LIGHT_BLOCK_BINDING);
+            shader.bindUniformBlock("ObjectBlock", OBJECT_BLOCK_BINDING);
+        };
+        lightCubeShader = new Shader("res/lightShader.vs", "res/lightShader.fs");
+        bindBlocks(*lightCubeShader);
+        // constant for the lifetime of each variant, no need to set them every frame
+        objShaders = new ShaderVariants("res/objShader.vs", "res/objShader.fs", nullptr,
+                                        FEATURE_INSTANCED | FEATURE_TEXTURE_ARRAY | FEATURE_SHADOWS |
+                                        FEATURE_PARABOLOID | FEATURE_GRID_SHADOW | FEATURE_LOCAL_LIGHTS |
+                                        FEATURE_LIGHTMAP | FEATURE_MULTI_DRAW,
+                                        [this, bindBlocks](Shader &shader) {
+                                            bindBlocks(shader);
+                                            shader.use();
+                                            shader.setInt("material.diffuse", 0);
+                                            shader.setInt("material.specular", 1);
+                                            shader.setFloat("material.shininess", 64.0f);
+                                            shader.setInt("depthMap", 2);
+                                            shader.setInt("paraboloidMap", 3);
+                                            shader.setInt("blockTextures", BLOCK_TEXTURE_UNIT);
+                                            shader.setInt("marks", MARK_UNIT);
+                                            shader.setFloat("markLayer", (float) bedrockLayer);
+                                            if (lightGrid) lightGrid->setUniforms(shader);
+                                            if (lightmap) lightmap->setUniforms(shader);
+                                            if (shadowMask) shadowMask->setUniforms(shader);
+                                        });
+        depthShaders = new ShaderVariants("res/shadow_mapping_depth.vs", "res/shadow_mapping_depth.fs",
+                                          "res/shadow_mapping_depth.gs", FEATURE_INSTANCED | FEATURE_MULTI_DRAW,
+                                          bindBlocks);
+        paraboloidShaders = new ShaderVariants("res/shadow_paraboloid_depth.vs", "res/shadow_paraboloid_depth.fs",
+                                               nullptr, FEATURE_INSTANCED | FEATURE_MULTI_DRAW, bindBlocks);
+        prepassShaders = new ShaderVariants("res/depth_prepass.vs", "res/depth_prepass.fs", nullptr,
+                                            FEATURE_INSTANCED | FEATURE_MULTI_DRAW, bindBlocks);
+    }
 
-    // Store the maze
-    models = new map<string, Model>;
-    for (const string &key : model_list) {
-        models->insert(pair<string, Model>(key, Model("res/assets/" + key + ".obj")));
+    // Every block type shares the stone geometry and one texture array, the level never reloads them
+    if (!blockModel) {
+        blockModel = new Model("res/assets/stone.obj");
+        blockTextures = new BlockTextureArray("res/assets/textures/blocks", block_textures);
+        blockBatch = new BlockBatch(blockModel->meshes[0], *blockTextures, stream);
     }
+    int stoneLayer = blockTextures->layer("stone");
+    int dirtLayer = blockTextures->layer("dirt");
+    bedrockLayer = blockTextures->layer("bedrock");
+
+    // Store the maze
     maze = new Maze(this->maze_len, this->maze_wid, 2.);
 //    maze->print_maze();   // just for debugging
 
@@ -110,18 +198,13 @@ void Application::init(int map_size, int maze_length, int maze_width) {
         floor_model[i] = new CubeModel[maze->get_col_num() + 2 * map_sz];
     }
 
+    blockBatch->clear();
+    highlightedBlocks.clear();
     for (int i = -map_sz; i < maze->get_row_num() + map_sz; ++i)
         for (int j = -map_sz; j < maze->get_col_num() + map_sz; ++j) {
-            // render the loaded model
-            floor_model[i + map_sz][j + map_sz].position = glm::vec3(i * 2., -2.f, j * 2.);
-
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, floor_model[i + map_sz][j + map_sz].position);
-            model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-
-            floor_model[i + map_sz][j + map_sz].model = model;
-            floor_model[i + map_sz][j + map_sz].model_res = glm::mat3(glm::transpose(glm::inverse(model)));
-            floor_model[i + map_sz][j + map_sz].type = "dirt";
+            CubeModel &cube = floor_model[i + map_sz][j + map_sz];
+            cube.position = glm::vec3(i * 2., -2.f, j * 2.);
+            cube.instance = blockBatch->add(cube.position, dirtLayer);
         }
 
     wall_model = new CubeModel **[maze->get_row_num()];
@@ -136,50 +219,84 @@ void Application::init(int map_size, int maze_length, int maze_width) {
         for (int j = 0; j < maze->get_col_num(); ++j) {
             if (!maze->isWall(i, j)) continue;
             for (int _ = 0; _ < 5; ++_) {
-                wall_model[i][j][_].type = "stone";
-                wall_model[i][j][_].position = glm::vec3(i * 2., _ * 2., j * 2.);
-
-                glm::mat4 model = glm::mat4(1.0f);
-                model = glm::translate(model, wall_model[i][j][_].position);
-                model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-
-                wall_model[i][j][_].model = model;
-                wall_model[i][j][_].model_res = glm::mat3(glm::transpose(glm::inverse(model)));
+                CubeModel &cube = wall_model[i][j][_];
+                cube.position = glm::vec3(i * 2., _ * 2., j * 2.);
+                int layer = stoneLayer;
+                if (rand() % 12 == 0) {
+                    int variant = blockTextures->layer(wall_variants[rand() % 3]);
+                    layer = variant < 0 ? stoneLayer : variant;
+                }
+                cube.instance = blockBatch->add(cube.position, layer);
             }
         }
 
-    // Configure depth map FBO
+    // one light grid cell per maze cell, floor border included
+    delete lightGrid;
+    lightGrid = new LightGrid(glm::vec2(-map_sz * 2 - 1.0f, -map_sz * 2 - 1.0f), 2.0f,
+                              maze->get_row_num() + 2 * map_sz, maze->get_col_num() + 2 * map_sz, stream);
+    // variants built during an earlier level still point at the old grid
+    objShaders->forEach([this](Shader &shader) { lightGrid->setUniforms(shader); });
+    placeTorches();
+    bakeLightmap();
+
+    // the walls as the grid shadow mode sees them, from the floor's top to the top of the fifth layer
+    std::vector<uint8_t> walls((size_t) maze->get_row_num() * maze->get_col_num());
+    for (int i = 0; i < maze->get_row_num(); ++i)
+        for (int j = 0; j < maze->get_col_num(); ++j)
+            walls[i * maze->get_col_num() + j] = maze->isWall(i, j);
+    delete shadowMask;
+    shadowMask = new ShadowMask(walls, maze->get_row_num(), maze->get_col_num(), map_sz, -1.0f, 9.0f);
+    objShaders->forEach([this](Shader &shader) { shadowMask->setUniforms(shader); });
+
+    // Configure depth map FBO and its depth cubemap texture
     glGenFramebuffers(1, &depthMapFBO);
-    // Create depth cubemap texture
     glGenTextures(1, &depthCubeMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubeMap);
-    for (GLuint i = 0; i < 6; ++i)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0,
-                     GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    // Attach cubemap as depth map FBO's color buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubeMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    setShadowResolution(SHADOW_WIDTH);
+
+    // Configure the single-hemisphere paraboloid map used by ShadowMode::PARABOLOID, kept across levels
+    if (!paraboloidFBO) {
+        glGenFramebuffers(1, &paraboloidFBO);
+        glGenTextures(1, &paraboloidMap);
+        setParaboloidResolution(PARABOLOID_SIZE);
+    }
 
-    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    // Offscreen scene target for the governor's render scale, kept across levels
+    if (!sceneFBO) {
+        glGenFramebuffers(1, &sceneFBO);
+        glGenRenderbuffers(1, &sceneColor);
+        glGenRenderbuffers(1, &sceneDepth);
+        resizeSceneTarget();
+    }
+    if (!insetFBO) {
+        glGenFramebuffers(1, &insetFBO);
+        glGenRenderbuffers(1, &insetColor);
+        glGenRenderbuffers(1, &insetDepth);
+        resizeInsetTarget();
+    }
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
     // Collections
     collection = new Model("res/cube/Cube.obj");
+    if (debug) {
+        std::pair<const char *, Model *> loaded[] = {{"ball", characterBallAdv}, {"UFO", characterBallUav},
+                                                     {"block", blockModel}, {"cube", collection}};
+        for (auto &model : loaded) {
+            std::cout << "Mesh memory " << model.first << ": " << model.second->gpuMemory() << " bytes (full "
+                      << model.second->fullMemory() << "), ACMR " << model.second->acmr(false) << " -> "
+                      << model.second->acmr(true) << std::endl;
+        }
+        MeshArena &arena = Mesh::arenaFor(VertexFormat::COMPACT, GL_UNSIGNED_SHORT);
+        std::cout << "Mesh arena: " << arena.usedBytes() << " of " << arena.capacityBytes() << " bytes" << std::endl;
+    }
 
-    markWall = new int[3] {-1, -1, -1};
+    delete marks;
+    marks = new MarkGrid(maze->get_row_num(), 5, maze->get_col_num());
 }
 
 void Application::preRender() {
     // per-frame time logic
+    frameStartTime = glfwGetTime();
     float currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
@@ -187,9 +304,6 @@ void Application::preRender() {
 
     processInput(); // input
 
-    glClearColor(.0f, .0f, .0f, 1.f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
     // update uav's position with the adventurer
     if (adventurer_handle && bindAdventurer) {
         camera_uav.position = camera_adventurer.position + glm::vec3(-1., 12., -1.);
@@ -244,209 +358,723 @@ void Application::preRender() {
 }
 
 void Application::render() {
+    stream->beginFrame();
 
 //    // view/projection transformations
     glm::mat4 projection = glm::perspective(glm::radians(camera->fov), (float) width / (float) height,
                                             camera->zNear, camera->zFar);
     glm::mat4 view = camera->getViewMatrix();
     glm::vec3 lightPos(camera_uav.position.x, camera_uav.position.y + 1.0f, camera_uav.position.z);
+    glm::mat4 insetProjection = glm::perspective(glm::radians(camera_uav.fov), (float) width / (float) height,
+                                                 camera_uav.zNear, camera_uav.zFar);
+    glm::mat4 insetView = camera_uav.getViewMatrix();
+    sceneLod = {camera->position, (float) sceneHeight / (2.0f * std::tan(glm::radians(camera->fov) * 0.5f)),
+                camera->zNear, LOD_PIXEL_ERROR};
+    insetLod = {camera_uav.position, (float) insetHeight / (2.0f * std::tan(glm::radians(camera_uav.fov) * 0.5f)),
+                camera_uav.zNear, LOD_PIXEL_ERROR};
+    // shadow LODs are seen from the light at the map's texel density: a cube face spreads its width
+    // over 90 degrees, the paraboloid warp has its coarsest texels straight below the light
+    shadowLod = {lightPos, shadowMode == ShadowMode::PARABOLOID
+                           ? (float) PARABOLOID_SIZE / 4.0f
+                           : (float) SHADOW_WIDTH / (2.0f * std::tan(glm::radians(90.0f) * 0.5f)),
+                 SHADOW_NEAR, SHADOW_LOD_PIXEL_ERROR};
 
-    // 0. Create depth cubemap transformation matrices
-    GLfloat aspect = (GLfloat) SHADOW_WIDTH / (GLfloat) SHADOW_HEIGHT;
-    GLfloat near = 1.0f;
     GLfloat far = 10000.0f;
-    glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), aspect, near, far);
-    std::vector<glm::mat4> shadowTransforms;
-    shadowTransforms.push_back(
-            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0)));
-    shadowTransforms.push_back(
-            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0)));
-    shadowTransforms.push_back(
-            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0, 1.0, 0.0), glm::vec3(0.0, 0.0, 1.0)));
-    shadowTransforms.push_back(
-            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, -1.0)));
-    shadowTransforms.push_back(
-            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, -1.0, 0.0)));
-    shadowTransforms.push_back(
-            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, -1.0, 0.0)));
-
-    // 1. Render scene to depth cubemap
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
-    depthShader->use();
-    for (GLuint i = 0; i < 6; ++i)
-        depthShader->setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
-    depthShader->setFloat("far_plane", far);
-    depthShader->setVec3("lightPos", lightPos);
-    renderObject(depthShader);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // don't forget to enable shader before setting uniforms
-    glViewport(0, 0, width, height);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    objShader->use();
-    objShader->setInt("material.diffuse", 0);
-    objShader->setInt("material.specular", 1);
-    objShader->setFloat("material.shininess", 64.0f);
+    // 0. Per-frame and per-light uniform blocks, shared by every program below
+    FrameUniforms frame{};
+    frame.projection = projection;
+    frame.view = view;
+    frame.viewPos = glm::vec4(camera->position, 1.0f);
+    frame.far_plane = far;
+    frame.bakedLightScale = torchFlicker((float) glfwGetTime(), 0.0f);
+    stream->bindUniformBlock(FRAME_BLOCK_BINDING, frame);
+    updateLightBlock(lightPos, far);
+    updateLights();
+    // the inset is redrawn every INSET_INTERVAL frames, its list is only culled for those
+    bool inset = insetVisible();
+    if (!inset) insetValid = false;
+    bool insetDue = inset && (!insetValid || frameIndex % INSET_INTERVAL == 0);
+    glm::mat4 insetViewProjection = insetProjection * insetView;
+    prepareFrame(projection * view, lightPos, insetDue ? &insetViewProjection : nullptr);
+
+    // Passes of the frame; below full scale the scene goes to the offscreen target and is upscaled
+    const QualityLevel &quality = governor.level();
+    // the grid mode has no depth pass, only a mask rebuilt on the CPU when the light moves
+    bool gridShadows = shadows && shadowMode == ShadowMode::GRID;
+    GpuTimer *shadowTimer = shadowMode == ShadowMode::GRID ? nullptr : shadowTimers[(int) shadowMode];
+    if (gridShadows) shadowMask->update(lightPos, *threadPool);
+    bool scaled = sceneWidth != width || sceneHeight != height;
+    GLuint sceneTarget = scaled ? sceneFBO : 0;
+    const char *sceneColor = scaled ? "scene color" : RenderGraph::BACKBUFFER;
+
+    // 1. Render scene to the shadow map of the selected mode, at the governor's update rate. It is
+    // declared with shadows off too (P), the graph drops it then since no pass reads the map
+    if (shadowMode != ShadowMode::GRID && frameIndex % quality.shadowInterval == 0) {
+        GraphPass shadow;
+        shadow.name = "shadow";
+        shadow.clear = GL_DEPTH_BUFFER_BIT;
+        shadow.writes = {"shadow map"};
+        if (shadowMode == ShadowMode::PARABOLOID) {
+            shadow.framebuffer = paraboloidFBO;
+            shadow.width = shadow.height = PARABOLOID_SIZE;
+            // the paraboloid warp does not preserve winding reliably, keep both faces
+            shadow.state.cullFace = false;
+        } else {
+            shadow.framebuffer = depthMapFBO;
+            shadow.width = SHADOW_WIDTH;
+            shadow.height = SHADOW_HEIGHT;
+        }
+        shadow.execute = [this, shadowTimer] {
+            shadowTimer->begin();
+            if (shadowMode == ShadowMode::PARABOLOID) {
+                renderShadowParaboloid();
+            } else {
+                renderShadowCubeMap();
+            }
+            shadowTimer->end();
+        };
+        renderGraph.addPass(shadow);
+    }
+
+    // 2. Depth pre-pass, so the shadow sampling fragment shader runs once per pixel
+    if (depthPrepass) {
+        GraphPass prepass;
+        prepass.name = "depth pre-pass";
+        prepass.framebuffer = sceneTarget;
+        prepass.width = sceneWidth;
+        prepass.height = sceneHeight;
+        prepass.clear = GL_DEPTH_BUFFER_BIT;
+        prepass.state.colorWrite = false;
+        prepass.writes = {"scene depth"};
+        prepass.execute = [this] {
+            sceneTimer->begin();
+            renderObject(prepassShaders, PASS_DEPTH);
+        };
+        renderGraph.addPass(prepass);
+    }
+
+    // 3. Render the scene, sampler units and the material were set once in init()
+    GraphPass opaque;
+    opaque.name = "opaque";
+    opaque.framebuffer = sceneTarget;
+    opaque.width = sceneWidth;
+    opaque.height = sceneHeight;
+    opaque.clear = depthPrepass ? GL_COLOR_BUFFER_BIT : GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT;
+    if (depthPrepass) {
+        // depth is final already, only the visible surface gets shaded
+        opaque.state.depthFunc = GL_LEQUAL;
+        opaque.state.depthWrite = false;
+        opaque.reads.emplace_back("scene depth");
+    }
+    if (shadows) opaque.reads.emplace_back("shadow map");
+    opaque.writes = {sceneColor, "scene depth"};
+    // shadows and local lights are compiled into the variant rather than branched on per fragment
+    unsigned features = 0;
+    if (shadows) {
+        features |= FEATURE_SHADOWS;
+        if (shadowMode == ShadowMode::PARABOLOID) features |= FEATURE_PARABOLOID;
+        if (shadowMode == ShadowMode::GRID) features |= FEATURE_GRID_SHADOW;
+    }
+    if (lightGrid->lightCount() > 0) features |= FEATURE_LOCAL_LIGHTS;
+    opaque.execute = [this, features] {
+        if (!depthPrepass) sceneTimer->begin();
+        bindSceneTextures();
+        renderObject(objShaders, PASS_OPAQUE, features);
+    };
+    renderGraph.addPass(opaque);
+
+    // 4. The UAV, drawn as the light itself
+    GraphPass light;
+    light.name = "light";
+    light.framebuffer = sceneTarget;
+    light.width = sceneWidth;
+    light.height = sceneHeight;
+    light.reads = {sceneColor, "scene depth"};
+    light.writes = {sceneColor, "scene depth"};
+    light.execute = [this, lightPos] {
+        lightCubeShader->use();
+        renderLight(lightPos);
+    };
+    renderGraph.addPass(light);
+
+    // 4b. The UAV's view for the inset, with the frame's shadow map and a list culled to its frustum
+    if (insetDue) {
+        GraphPass uavView;
+        uavView.name = "inset";
+        uavView.framebuffer = insetFBO;
+        uavView.width = insetWidth;
+        uavView.height = insetHeight;
+        uavView.clear = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT;
+        if (shadows) uavView.reads.emplace_back("shadow map");
+        uavView.writes = {"inset"};
+        uavView.execute = [this, features, frame, insetProjection, insetView] {
+            FrameUniforms uavFrame = frame;
+            uavFrame.projection = insetProjection;
+            uavFrame.view = insetView;
+            uavFrame.viewPos = glm::vec4(camera_uav.position, 1.0f);
+            stream->bindUniformBlock(FRAME_BLOCK_BINDING, uavFrame);
+            bindSceneTextures();
+            renderObject(objShaders, PASS_OPAQUE, features, insetList, INSET_CULL_SLOT);
+            // later passes still see the main camera
+            stream->bindUniformBlock(FRAME_BLOCK_BINDING, frame);
+            insetValid = true;
+        };
+        renderGraph.addPass(uavView);
+    }
+
+    // 5. Upscale to the window
+    if (scaled) {
+        GraphPass upscale;
+        upscale.name = "upscale";
+        upscale.width = width;
+        upscale.height = height;
+        upscale.reads = {sceneColor};
+        upscale.writes = {RenderGraph::BACKBUFFER};
+        upscale.execute = [this] {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO);
+            glBlitFramebuffer(0, 0, sceneWidth, sceneHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        };
+        renderGraph.addPass(upscale);
+    }
+
+    // 5b. The inset over the bottom left corner, stretched from its reduced resolution
+    if (inset) {
+        GraphPass composite;
+        composite.name = "inset composite";
+        composite.width = width;
+        composite.height = height;
+        composite.reads = {"inset", sceneColor};
+        composite.writes = {RenderGraph::BACKBUFFER};
+        composite.execute = [this] {
+            int margin = 20;
+            int w = (int) (width * INSET_SIZE), h = (int) (height * INSET_SIZE);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, insetFBO);
+            glBlitFramebuffer(0, 0, insetWidth, insetHeight, margin, margin, margin + w, margin + h,
+                              GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        };
+        renderGraph.addPass(composite);
+    }
 
-    objShader->setVec3("lights[0].position", lightPos);
-    objShader->setVec3("lights[0].ambient", 0.3f, 0.3f, 0.3f);
-    objShader->setVec3("lights[0].diffuse", 0.95f, 0.95f, 0.95f);
-    objShader->setVec3("lights[0].specular", 1.0f, 1.0f, 1.0f);
-    objShader->setFloat("lights[0].constant", 1.0f);
-    objShader->setFloat("lights[0].linear", 0.01f);
-    objShader->setFloat("lights[0].quadratic", 0.00025);
+    // 6. Render Messages on top, at window resolution
+    GraphPass messages;
+    messages.name = "hud";
+    messages.width = width;
+    messages.height = height;
+    messages.state.depthTest = false;
+    messages.state.depthWrite = false;
+    messages.state.blend = true;
+    messages.reads = {RenderGraph::BACKBUFFER};
+    messages.writes = {RenderGraph::BACKBUFFER};
+    messages.execute = [this] {
+        updateHud();
+        hud->draw();
+        sceneTimer->end();
+    };
+    renderGraph.addPass(messages);
+
+    renderGraph.execute();
+
+    // the shadow pass only costs its share of the frames it runs in
+    double cpuMs = (glfwGetTime() - frameStartTime) * 1000.0;
+    double gpuMs = sceneTimer->milliseconds();
+    if (shadowTimer) gpuMs += shadowTimer->milliseconds() / quality.shadowInterval;
+    if (governorEnabled && governor.update(cpuMs, gpuMs)) applyQuality();
+    ++frameIndex;
+}
+
+void Application::applyQuality() {
+    const QualityLevel &quality = governor.level();
+    if (quality.shadowSize != SHADOW_WIDTH) {
+        setShadowResolution(quality.shadowSize);
+    }
+    applyParaboloidResolution();
+    resizeSceneTarget();
+}
 
-    objShader->setVec3("viewPos", camera->position);
+void Application::applyParaboloidResolution() {
+    // the K choice is the cap, a lower level shrinks it by the same factor as the cube map
+    GLuint size = paraboloidChoice * governor.level().shadowSize / QualityGovernor::full().shadowSize;
+    if (size != PARABOLOID_SIZE) setParaboloidResolution(size);
+}
 
-    objShader->setMat4("projection", projection);
-    objShader->setMat4("view", view);
+void Application::resizeSceneTarget() {
+    renderGraph.invalidate();
+    float scale = governor.level().renderScale;
+    sceneWidth = std::max(1, (int) (width * scale));
+    sceneHeight = std::max(1, (int) (height * scale));
+    if (sceneWidth == width && sceneHeight == height) return;
+
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, sceneWidth, sceneHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, sceneWidth, sceneHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Scene framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
 
-    objShader->setBool("shadows", shadows);
-    objShader->setFloat("far_plane", far);
+void Application::resizeInsetTarget() {
+    renderGraph.invalidate();
+    insetValid = false;
+    insetWidth = std::max(1, (int) (width * INSET_SIZE * INSET_SCALE));
+    insetHeight = std::max(1, (int) (height * INSET_SIZE * INSET_SCALE));
+
+    glBindRenderbuffer(GL_RENDERBUFFER, insetColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, insetWidth, insetHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, insetDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, insetWidth, insetHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, insetFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, insetColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, insetDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Inset framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
 
-    objShader->setInt("depthMap", 2);
+void Application::bindSceneTextures() {
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubeMap);
-    renderObject(objShader);
-
-    lightCubeShader->use();
-    lightCubeShader->setMat4("projection", projection);
-    lightCubeShader->setMat4("view", view);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, paraboloidMap);
+    lightGrid->bind();
+    marks->bind();
+    lightmap->bind();
+    shadowMask->bind();
+}
 
-    renderLight(lightPos);
+void Application::initHud() {
+    glm::vec3 yellow(0.8f, 0.8f, 0.2f), green(0.5f, 0.8f, 0.2f), cyan(0.2f, 0.8f, 0.8f), blue(0.3f, 0.7f, 0.9f);
+    glm::vec3 purple(0.5f, 0.2f, 0.5f), pink(0.95f, 0.29f, 0.49f);
+    hud = new Hud(freeType);
+    hudLabels.fps = hud->addLabel(0.5f, yellow);
+    hudLabels.state = hud->addLabel(1.0f, green);
+    hudLabels.shadow = hud->addLabel(0.4f, yellow);
+    hudLabels.queue = hud->addLabel(0.4f, yellow);
+    hudLabels.stream = hud->addLabel(0.4f, yellow);
+    hudLabels.quality = hud->addLabel(0.4f, yellow);
+    hudLabels.graph = hud->addLabel(0.4f, yellow);
+    hudLabels.time = hud->addLabel(0.8f, cyan);
+    hudLabels.cursor = hud->addLabel(0.5f, blue, "o");
+    hudLabels.help[0] = hud->addLabel(0.4f, purple, "enter R to replay or level up");
+    hudLabels.help[1] = hud->addLabel(0.4f, purple, "enter E to mark a wall block");
+    hudLabels.help[2] = hud->addLabel(0.4f, purple, "enter 1 to adv mode");
+    hudLabels.help[3] = hud->addLabel(0.4f, purple, "enter 2 to uav mode");
+    hudLabels.mode = hud->addLabel(1.5f, green);
+    for (int &thing : hudLabels.things)
+        thing = hud->addLabel(0.6f, pink);
+    hudLabels.go = hud->addLabel(3.0f, pink, "go go go");
+    hudLabels.win = hud->addLabel(3.0f, pink, "you win");
+    hudLabels.level = hud->addLabel(3.0f, pink);
+    hudLabels.markRemoved = hud->addLabel(0.6f, pink, "wall mark removed");
+    hudLabels.marked = hud->addLabel(0.6f, pink);
+    hudLabels.capture = hud->addLabel(0.5f, pink);
+    layoutHud();
+}
 
-    // Render Messages
+void Application::layoutHud() {
+    // only depends on the framebuffer size
     freeType->use();
-    projection = glm::ortho(0.0f, static_cast<GLfloat>(width), 0.0f, static_cast<GLfloat>(height));
-    freeType->setMat4("projection", projection);
-    std::stringstream ss_fps;
-    ss_fps << (int) (1.0f / deltaTime) << " FPS";
-    freeType->renderText(ss_fps.str(), 25.0f, height - 49.0f, 0.5f, glm::vec3(0.8f, 0.8f, 0.2f));
-    freeType->renderText(gamestates[gameState], 25.0f, 25.0f, 1.0f, glm::vec3(0.5f, 0.8f, 0.2f));
-
-    std::stringstream ss_time;
-    ss_time << "time " << (int) gameTime;
-    freeType->renderText(ss_time.str(), width / 2. - 2 * font_size * 0.8f, 25.0f, 0.8f, glm::vec3(0.2f, 0.8f, 0.8f));
-
-    freeType->renderText("o", width / 2., height / 2., 0.5f, glm::vec3(0.3f, 0.7f, 0.9f));   // render cursor
-
-    freeType->renderText("enter R to replay or level up", width - 383.0f, height - 40.0f, 0.4f, glm::vec3(0.5f, 0.2f, 0.5f));
-    freeType->renderText("enter E to mark a wall block", width - 378.0f, height - 70.0f, 0.4f, glm::vec3(0.5f, 0.2f, 0.5f));
-    freeType->renderText("enter 1 to adv mode", width - 262.0f, height - 100.0f, 0.4f, glm::vec3(0.5f, 0.2f, 0.5f));
-    freeType->renderText("enter 2 to uav mode", width - 266.0f, height - 130.0f, 0.4f, glm::vec3(0.5f, 0.2f, 0.5f));
-
-    if (adventurer_handle) {
-        freeType->renderText("a", width - 100.0f, 25.0f, 1.5f, glm::vec3(0.5f, 0.8f, 0.2f));
-    } else {
-        freeType->renderText("u", width - 100.0f, 25.0f, 1.5f, glm::vec3(0.5f, 0.8f, 0.2f));
-    }
+    freeType->setMat4("projection", glm::ortho(0.0f, static_cast<GLfloat>(width), 0.0f, static_cast<GLfloat>(height)));
+    hud->setPosition(hudLabels.fps, 25.0f, height - 49.0f);
+    hud->setPosition(hudLabels.state, 25.0f, 25.0f);
+    hud->setPosition(hudLabels.shadow, 25.0f, height - 79.0f);
+    hud->setPosition(hudLabels.queue, 25.0f, height - 104.0f);
+    hud->setPosition(hudLabels.stream, 25.0f, height - 129.0f);
+    hud->setPosition(hudLabels.quality, 25.0f, height - 154.0f);
+    hud->setPosition(hudLabels.graph, 25.0f, height - 179.0f);
+    hud->setPosition(hudLabels.time, width / 2. - 2 * font_size * 0.8f, 25.0f);
+    hud->setPosition(hudLabels.cursor, width / 2., height / 2.);
+    hud->setPosition(hudLabels.help[0], width - 383.0f, height - 40.0f);
+    hud->setPosition(hudLabels.help[1], width - 378.0f, height - 70.0f);
+    hud->setPosition(hudLabels.help[2], width - 262.0f, height - 100.0f);
+    hud->setPosition(hudLabels.help[3], width - 266.0f, height - 130.0f);
+    hud->setPosition(hudLabels.mode, width - 100.0f, 25.0f);
+    for (int i = 0; i < 3; ++i)
+        hud->setPosition(hudLabels.things[i], width / 2 - 250, height / 2 - 35 * (i + 1));
+    hud->setPosition(hudLabels.go, width / 2 - 400, height / 2);
+    hud->setPosition(hudLabels.win, width / 2 - 300, height / 2);
+    hud->setPosition(hudLabels.level, width / 2 - 300, height / 2);
+    hud->setPosition(hudLabels.markRemoved, width / 2 - 150, height / 2 + 150);
+    hud->setPosition(hudLabels.marked, width / 2 - 250, height / 2 + 150);
+    hud->setPosition(hudLabels.capture, width / 2 - 150, height - 49.0f);
+}
 
-    if (gameState == 1 && glfwGetTime() - thingOneCollectedTime <= 3) {
-        std::stringstream ss_thing1;
-        ss_thing1 << "Item collected with bonus " << (int) maze->getThingOne().bonus;
-        freeType->renderText(ss_thing1.str(), width / 2 - 250, height / 2 - 35, 0.6f, glm::vec3(0.95f, 0.29f, 0.49f));
+void Application::updateHud() {
+    double now = glfwGetTime();
+
+    // frame statistics change every frame, refresh them a few times a second
+    if (now - hudStatsTime >= HUD_STATS_INTERVAL) {
+        hudStatsTime = now;
+        hud->setNumber(hudLabels.fps, "", (int) (1.0f / deltaTime), " FPS");
+
+        // side-by-side shadow pass cost, press O to switch mode and K to change the paraboloid size;
+        // only the active mode is measured, the others keep the number from when they last ran
+        std::stringstream ss_shadow;
+        ss_shadow.precision(2);
+        ss_shadow << std::fixed << "shadow " << shadowModeNames[(int) shadowMode];
+        for (int i = 0; i < 2; ++i) {
+            ss_shadow << "  " << shadowModeNames[i] << " ";
+            if (shadowTimers[i]->valid()) ss_shadow << shadowTimers[i]->milliseconds() << "ms";
+            else ss_shadow << "-";
+            if (shadowTimers[i]->valid() && !(shadows && (int) shadowMode == i)) ss_shadow << " stale";
+        }
+        ss_shadow << "  grid " << shadowMask->buildMilliseconds() << "ms cpu";
+        if (!(shadows && shadowMode == ShadowMode::GRID)) ss_shadow << " stale";
+        hud->setText(hudLabels.shadow, ss_shadow.str());
+
+        // render queue: submitted draws, the calls they went out in and GL binds skipped by the state cache
+        const GLStateCache::Stats &queueStats = renderQueue->lastFrame();
+        std::stringstream ss_queue;
+        ss_queue << renderQueue->lastFrameDraws() << " draws in " << renderQueue->lastFrameCalls() << " calls  "
+                 << queueStats.changes() << " binds  "
+                 << queueStats.skipped() << " avoided  " << lightGrid->lightCount() << " lights  "
+                 << lightGrid->maxLightsPerCell() << " per cell";
+        hud->setText(hudLabels.queue, ss_queue.str());
+
+        // bytes streamed last frame and how often the ring caught up with the GPU
+        std::stringstream ss_stream;
+        ss_stream << "stream " << stream->lastFrameBytes() / 1024 << "KB  "
+                  << (stream->persistent() ? "persistent" : "unsynchronized") << "  " << stream->waits() << " waits";
+        if (gpuCulling && blockBatch->gpuCulling())
+            ss_stream << "  gpu culled " << blockBatch->size() << " blocks  ";
+        else
+            ss_stream << "  " << passLists[PASS_OPAQUE].blocks.size() << "/" << blockBatch->size() << " blocks  ";
+        ss_stream << threadPool->size() << " threads";
+        hud->setText(hudLabels.stream, ss_stream.str());
+
+        // governor level against the frame budget, press G to turn it off
+        const QualityLevel &quality = governor.level();
+        std::stringstream ss_quality;
+        ss_quality.precision(1);
+        ss_quality << std::fixed << "quality " << (governorEnabled ? std::to_string(governor.levelIndex()) : "off")
+                   << "  scale " << (int) (quality.renderScale * 100) << "%  shadow " << SHADOW_WIDTH << " parab "
+                   << PARABOLOID_SIZE << "/" << paraboloidChoice << " every " << quality.shadowInterval << "  "
+                   << governor.frameMs() << "/" << governor.budgetMs() << "ms";
+        hud->setText(hudLabels.quality, ss_quality.str());
+
+        // render graph: passes run and culled, state changes it saved, press Z for the pre-pass;
+        // then the program variants compiled so far
+        const RenderGraph::Stats &graphStats = renderGraph.lastFrame();
+        std::stringstream ss_graph;
+        ss_graph << graphStats.passes << " passes  " << graphStats.culled << " culled  "
+                 << graphStats.stateSkipped << "/" << graphStats.stateChanges + graphStats.stateSkipped
+                 << " states kept  pre-pass " << (depthPrepass ? "on" : "off") << "  inset "
+                 << (insetVisible() ? std::to_string(insetWidth) + "x" + std::to_string(insetHeight) + "/" +
+                                      std::to_string(INSET_INTERVAL) : "off") << "  "
+                 << objShaders->built() + depthShaders->built() + paraboloidShaders->built() + prepassShaders->built()
+                 << " variants";
+        hud->setText(hudLabels.graph, ss_graph.str());
+
+        // frames of the running recording, and the ones the ring or the encoder could not take
+        std::stringstream ss_capture;
+        ss_capture << "rec " << capture->framesCaptured() << " frames  " << capture->framesDropped() << " dropped";
+        hud->setText(hudLabels.capture, ss_capture.str());
     }
-    if (gameState == 1 && glfwGetTime() - thingTwoCollectedTime <= 3) {
-        std::stringstream ss_thing2;
-        ss_thing2 << "Item collected with bonus " << (int) maze->getThingTwo().bonus;
-        freeType->renderText(ss_thing2.str(), width / 2 - 250, height / 2 - 70, 0.6f, glm::vec3(0.95f, 0.29f, 0.49f));
+    hud->setVisible(hudLabels.capture, capture->recording());
+
+    hud->setText(hudLabels.state, gamestates[gameState]);
+    hud->setNumber(hudLabels.time, "time ", (int) gameTime);
+    hud->setText(hudLabels.mode, adventurer_handle ? "a" : "u");
+
+    double collectedTimes[] = {thingOneCollectedTime, thingTwoCollectedTime, thingThreeCollectedTime};
+    for (int i = 0; i < 3; ++i) {
+        bool shown = gameState == 1 && now - collectedTimes[i] <= 3;
+        hud->setVisible(hudLabels.things[i], shown);
+        if (shown) {
+            Thing thing = i == 0 ? maze->getThingOne() : i == 1 ? maze->getThingTwo() : maze->getThingThree();
+            hud->setNumber(hudLabels.things[i], "Item collected with bonus ", (int) thing.bonus);
+        }
     }
-    if (gameState == 1 && glfwGetTime() - thingThreeCollectedTime <= 3) {
-        std::stringstream ss_thing3;
-        ss_thing3 << "Item collected with bonus " << (int) maze->getThingThree().bonus;
-        freeType->renderText(ss_thing3.str(), width / 2 - 250, height / 2 - 105, 0.6f, glm::vec3(0.95f, 0.29f, 0.49f));
+
+    hud->setVisible(hudLabels.go, gameState == 1 && now - startTime <= 1);
+    hud->setVisible(hudLabels.win, gameState == 2 && now - endTime <= 3);
+    hud->setNumber(hudLabels.level, "level ", gameLevel);
+    hud->setVisible(hudLabels.level, now - levelTime <= 3);
+
+    bool markShown = gameState == 1 && now - markJitterTime <= 1;
+    hud->setVisible(hudLabels.markRemoved, markShown && markRemoved);
+    hud->setVisible(hudLabels.marked, markShown && !markRemoved);
+    hud->setNumber(hudLabels.marked, "wall marked, ", (int) marks->count(), " in total");
+}
+
+void Application::updateLightBlock(glm::vec3 lightPos, GLfloat far) {
+    LightUniforms light{};
+
+    // Create depth cubemap transformation matrices
+    GLfloat aspect = (GLfloat) SHADOW_WIDTH / (GLfloat) SHADOW_HEIGHT;
+    glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), aspect, SHADOW_NEAR, far);
+    light.shadowMatrices[0] =
+            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0));
+    light.shadowMatrices[1] =
+            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0));
+    light.shadowMatrices[2] =
+            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0, 1.0, 0.0), glm::vec3(0.0, 0.0, 1.0));
+    light.shadowMatrices[3] =
+            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, -1.0));
+    light.shadowMatrices[4] =
+            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, -1.0, 0.0));
+    light.shadowMatrices[5] =
+            shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, -1.0, 0.0));
+    // and the single downward hemisphere of the paraboloid map
+    light.lightView = glm::lookAt(lightPos, lightPos + glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, 1.0));
+
+    light.position = glm::vec4(lightPos, 1.0f);
+    light.ambient = glm::vec4(0.3f, 0.3f, 0.3f, 0.0f);
+    light.diffuse = glm::vec4(0.95f, 0.95f, 0.95f, 0.0f);
+    light.specular = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+    light.attenuation = glm::vec4(1.0f, 0.01f, 0.00025f, 0.0f);
+    stream->bindUniformBlock(LIGHT_BLOCK_BINDING, light);
+    // solve constant + linear * d + quadratic * d^2 = 256, the shadow pass culls blocks past it
+    float c = light.attenuation.x - 256.0f, l = light.attenuation.y, q = light.attenuation.z;
+    lightReach = (-l + std::sqrt(l * l - 4.0f * q * c)) / (2.0f * q);
+}
+
+void Application::placeTorches() {
+    // a torch on some of the wall faces looking into a corridor, picked by a hash so
+    // the same maze always gets the same torches
+    static const int directions[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    torches.clear();
+    for (int i = 0; i < maze->get_row_num(); ++i)
+        for (int j = 0; j < maze->get_col_num(); ++j) {
+            if (!maze->isWall(i, j)) continue;
+            for (int d = 0; d < 4; ++d) {
+                int ni = i + directions[d][0], nj = j + directions[d][1];
+                if (ni < 0 || nj < 0 || ni >= maze->get_row_num() || nj >= maze->get_col_num() ||
+                    maze->isWall(ni, nj))
+                    continue;
+                unsigned hash = (unsigned) i * 73856093u ^ (unsigned) j * 19349663u ^ (unsigned) d * 83492791u;
+                if (hash % 7 != 0) continue;
+                PointLight torch{};
+                torch.position = glm::vec3(i * 2.0f + directions[d][0] * 1.1f, 1.0f, j * 2.0f + directions[d][1] * 1.1f);
+                torch.radius = 6.0f;
+                torch.color = glm::vec3(2.0f, 1.1f, 0.45f);
+                torches.push_back(torch);
+            }
+        }
+}
+
+void Application::bakeLightmap() {
+    // the floor and wall blocks as solid cells, one layer of floor under five of walls
+    VoxelGrid grid(glm::ivec3(-map_sz, -1, -map_sz),
+                   glm::ivec3(maze->get_row_num() + 2 * map_sz, 6, maze->get_col_num() + 2 * map_sz));
+    for (int i = -map_sz; i < maze->get_row_num() + map_sz; ++i)
+        for (int j = -map_sz; j < maze->get_col_num() + map_sz; ++j)
+            grid.set(glm::ivec3(i, -1, j));
+    for (int i = 0; i < maze->get_row_num(); ++i)
+        for (int j = 0; j < maze->get_col_num(); ++j) {
+            if (!maze->isWall(i, j)) continue;
+            for (int layer = 0; layer < 5; ++layer)
+                grid.set(glm::ivec3(i, layer, j));
+        }
+
+    // the torches never move, updateLights() adds them to the light grid first
+    delete lightmap;
+    lightmap = new Lightmap(grid, torches, *threadPool);
+    objShaders->forEach([this](Shader &shader) { lightmap->setUniforms(shader); });
+    if (debug) {
+        std::cout << "Lightmap: " << lightmap->faceCount() << " faces baked in " << lightmap->bakeMilliseconds()
+                  << " ms on " << threadPool->size() << " threads" << std::endl;
     }
+}
 
-    if (gameState == 1 && glfwGetTime() - startTime <= 1) {
-        freeType->renderText("go go go", width / 2 - 400, height / 2, 3.0f, glm::vec3(0.95f, 0.29f, 0.49f));
+void Application::updateLights() {
+    float now = (float) glfwGetTime();
+    lightGrid->clear();
+    for (size_t i = 0; i < torches.size(); ++i) {
+        PointLight torch = torches[i];
+        torch.color *= torchFlicker(now, (float) i * 2.39996f);
+        lightGrid->add(torch);
     }
-    if (gameState == 2 && glfwGetTime() - endTime <= 3) {
-        freeType->renderText("you win", width / 2 - 300, height / 2, 3.0f, glm::vec3(0.95f, 0.29f, 0.49f));
+
+    // collectibles glow until picked up
+    bool collected[] = {maze->thingOneCollected, maze->thingTwoCollected, maze->thingThreeCollected};
+    glm::vec3 glow[] = {{0.4f, 1.6f, 0.6f}, {0.5f, 0.8f, 1.8f}, {1.6f, 0.5f, 1.4f}};
+    for (int i = 0; i < 3; ++i) {
+        if (collected[i]) continue;
+        Thing thing = i == 0 ? maze->getThingOne() : i == 1 ? maze->getThingTwo() : maze->getThingThree();
+        PointLight light{};
+        light.position = thing.position + glm::vec3(0.0f, 0.5f, 0.0f);
+        light.radius = 4.0f;
+        light.color = glow[i] * (0.8f + 0.2f * std::sin(now * 3.0f + (float) i));
+        lightGrid->add(light);
     }
+    lightGrid->build();
+}
+
+void Application::renderShadowCubeMap() {
+    // Render scene to depth cubemap, the geometry shader picks the face; target and clear come from the graph
+    renderObject(depthShaders, PASS_SHADOW);
+}
+
+void Application::renderShadowParaboloid() {
+    // One pass, no geometry shader: the lower hemisphere is all the UAV light can reach
+    renderObject(paraboloidShaders, PASS_SHADOW);
+}
+
+void Application::setShadowResolution(GLuint size) {
+    renderGraph.invalidate();
+    SHADOW_WIDTH = SHADOW_HEIGHT = size;
+    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubeMap);
+    for (GLuint i = 0; i < 6; ++i)
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // Attach cubemap as depth map FBO's color buffer
+    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubeMap, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Application::setParaboloidResolution(GLuint size) {
+    renderGraph.invalidate();
+    PARABOLOID_SIZE = size;
+    glBindTexture(GL_TEXTURE_2D, paraboloidMap);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, PARABOLOID_SIZE, PARABOLOID_SIZE, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindFramebuffer(GL_FRAMEBUFFER, paraboloidFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, paraboloidMap, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Paraboloid framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Application::prepareFrame(const glm::mat4 &viewProjection, glm::vec3 lightPos,
+                               const glm::mat4 *insetViewProjection) {
+    // highlight and mark selection only edits layers on the CPU, packing below picks them up
+    updateBlockHighlights();
 
-    std::stringstream ss_level;
-    ss_level << "level " << (int) gameLevel;
-    if (glfwGetTime() - levelTime <= 3) {
-        freeType->renderText(ss_level.str(), width / 2 - 300, height / 2, 3.0f, glm::vec3(0.95f, 0.29f, 0.49f));
+    // adventurer and the collections still lying around
+    std::vector<ModelDraw> models;
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(camera_adventurer.position.x, -0.7, camera_adventurer.position.z));
+    model = glm::scale(model, glm::vec3(0.3f, 0.3f, 0.3f));
+    models.push_back(ModelDraw{characterBallAdv, model, glm::mat3(glm::transpose(glm::inverse(model))), 0});
+    bool collected[] = {maze->thingOneCollected, maze->thingTwoCollected, maze->thingThreeCollected};
+    for (int i = 0; i < 3; ++i) {
+        if (collected[i]) continue;
+        Thing thing = i == 0 ? maze->getThingOne() : i == 1 ? maze->getThingTwo() : maze->getThingThree();
+        models.push_back(ModelDraw{collection, thing.model, thing.model_res, 0});
     }
 
-    if (gameState == 1 && glfwGetTime() - markJitterTime <= 1) {
-        if (markWall[0] < 0 || markWall[1] < 0 || markWall[2] < 0) {
-            freeType->renderText("wall mark removed", width / 2 - 150, height / 2 + 150, 0.6f, glm::vec3(0.95f, 0.29f, 0.49f));
+    // the models a view can see at the LOD it sees them, and its blocks into the batch's cull slot;
+    // on the GPU-driven path the CPU never looks at a block, only the dispatch grows with the maze
+    auto collect = [&](PassList &list, int slot, const Frustum *frustum, glm::vec3 origin, float maxDistance,
+                       const LodView &lod) {
+        list.models.clear();
+        for (const ModelDraw &draw : models) {
+            float scale = glm::length(glm::vec3(draw.transform[0]));
+            glm::vec3 center = glm::vec3(draw.transform * glm::vec4(draw.model->center, 1.0f));
+            if (frustum && !frustum->intersectsSphere(center, draw.model->radius * scale)) continue;
+            list.models.push_back(draw);
+            list.models.back().lod = modelLod(draw.model, draw.transform, lod);
+        }
+        if (gpuCulling && blockBatch->gpuCulling()) {
+            list.blocks.clear();
+            blockBatch->cull(slot, frustum, origin, maxDistance);
         } else {
-            freeType->renderText("wall marked", width / 2 - 100, height / 2 + 150, 0.6f, glm::vec3(0.95f, 0.29f, 0.49f));
+            blockBatch->pack(*threadPool, frustum, origin, maxDistance, list.blocks);
         }
+    };
+
+    // the camera only gets what its frustum can see, the light looks every way as far as it reaches;
+    // grid shadows need no shadow casters
+    if (shadowMode == ShadowMode::GRID) {
+        passLists[PASS_SHADOW].models.clear();
+        passLists[PASS_SHADOW].blocks.clear();
+    } else {
+        collect(passLists[PASS_SHADOW], PASS_SHADOW, nullptr, lightPos, lightReach, shadowLod);
+    }
+    Frustum frustum(viewProjection);
+    collect(passLists[PASS_OPAQUE], PASS_OPAQUE, &frustum, camera->position, camera->zFar, sceneLod);
+    if (insetViewProjection) {
+        Frustum insetFrustum(*insetViewProjection);
+        collect(insetList, INSET_CULL_SLOT, &insetFrustum, camera_uav.position, camera_uav.zFar, insetLod);
     }
 }
 
-void Application::renderObject(Shader *shader) {
+void Application::renderObject(ShaderVariants *variants, RenderPass pass, unsigned features) {
+    // the depth pre-pass draws the opaque list again
+    RenderPass source = pass == PASS_SHADOW ? PASS_SHADOW : PASS_OPAQUE;
+    renderObject(variants, pass, features, passLists[source], source);
+}
+
+void Application::renderObject(ShaderVariants *variants, RenderPass pass, unsigned features, const PassList &list,
+                               int cullSlot) {
     // render
     // ------
+    // submit what prepareFrame() collected; the render queue sorts the draws and skips redundant binds,
+    // on the GPU-driven path it also merges them into multi-draws
+    bool gpuDriven = gpuCulling && blockBatch->gpuCulling();
+    bool multiDraw = gpuDriven && RenderQueue::multiDrawSupported();
+    Shader *shader = variants->get(features | (multiDraw ? FEATURE_MULTI_DRAW : 0u));
+    for (const ModelDraw &draw : list.models) {
+        renderQueue->submit(pass, shader, draw.model, draw.transform, draw.normalMatrix, draw.lod);
+    }
+    renderQueue->flush(multiDraw);
+
+    // and every visible floor and wall block in one instanced draw
+    bool textured = pass == PASS_OPAQUE;
+    unsigned blockFeatures = textured ? FEATURE_TEXTURE_ARRAY | (bakedLighting ? FEATURE_LIGHTMAP : 0u) : 0u;
+    Shader *blockShader = variants->get(features | FEATURE_INSTANCED | blockFeatures);
+    blockShader->use();
+    if (gpuDriven)
+        blockBatch->drawCulled(cullSlot, textured);
+    else
+        blockBatch->draw(textured, list.blocks);
+}
 
-    // Render adventurer
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(camera_adventurer.position.x, -0.7, camera_adventurer.position.z));
-    model = glm::scale(model, glm::vec3(0.3f, 0.3f, 0.3f));
-    shader->setMat4("model", model);
-    shader->setMat3("model_res", glm::mat3(glm::transpose(glm::inverse(model))));
-    characterBallAdv->Draw(*shader);
-
-    // three collections
-    if (!maze->thingOneCollected) {
-        shader->setMat4("model", maze->getThingOne().model);
-        shader->setMat3("model_res", maze->getThingOne().model_res);
-        collection->Draw(*shader);
-    }
-    if (!maze->thingTwoCollected) {
-        shader->setMat4("model", maze->getThingTwo().model);
-        shader->setMat3("model_res", maze->getThingTwo().model_res);
-        collection->Draw(*shader);
-    }
-    if (!maze->thingThreeCollected) {
-        shader->setMat4("model", maze->getThingThree().model);
-        shader->setMat3("model_res", maze->getThingThree().model_res);
-        collection->Draw(*shader);
-    }
-
-//    for(int i = -map_sz; i < maze->get_row_num() + map_sz; ++i)
-//        for(int j = -map_sz; j < maze->get_col_num() + map_sz; ++j) {
-//            // render the loaded model
-//            glm::mat4 model = glm::mat4(1.0f);
-//            model = glm::translate(model,
-//                                   glm::vec3(i * 2., -4.f, j * 2.)); // translate it down so it's at the center of the scene
-//            model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));    // it's a bit too big for our scene, so scale it down
-//            ourShader->setMat4("model", model);
-//            models->at("bedrock").Draw(*ourShader);
-//        }
-
-    for (int i = 0; i < maze->get_row_num() + 2 * map_sz; ++i)
-        for (int j = 0; j < maze->get_col_num() + 2 * map_sz; ++j) {
-            // render the loaded model
-            shader->setMat4("model", floor_model[i][j].model);
-            shader->setMat3("model_res", floor_model[i][j].model_res);
-            floor_model[i][j].type = ((gameState == 1 && maze->start.x == i - map_sz && maze->start.y == j - map_sz) ||
-                                      (gameState == 2 && maze->end.x == i - map_sz && maze->end.y == j - map_sz))
-                                     ? "bedrock" : "dirt";
-            models->at(floor_model[i][j].type).Draw(*shader);
-        }
+void Application::updateBlockHighlights() {
+    // bedrock marks the start/end tile and the pointed-at wall block, marked ones come from the mark grid
+    std::vector<int> highlighted;
+    if (gameState == 1) {
+        highlighted.push_back(floor_model[(int) maze->start.x + map_sz][(int) maze->start.y + map_sz].instance);
+    }
+    if (gameState == 2) {
+        highlighted.push_back(floor_model[(int) maze->end.x + map_sz][(int) maze->end.y + map_sz].instance);
+    }
+    if (gameState == 1) {
+        int *curPointAt = camera->getPointAt(maze, 2.);
+        if (isWallBlock(curPointAt))
+            highlighted.push_back(wall_model[curPointAt[0]][curPointAt[2]][curPointAt[1]].instance);
+        delete[] curPointAt;
+    }
 
-    int *curPointAt = camera->getPointAt(maze, 2.);
+    // restore the blocks that lost their highlight
+    for (int instance : highlightedBlocks) {
+        if (std::find(highlighted.begin(), highlighted.end(), instance) == highlighted.end())
+            blockBatch->setLayer(instance, blockBatch->baseLayer(instance));
+    }
+    for (int instance : highlighted) {
+        blockBatch->setLayer(instance, bedrockLayer);
+    }
+    highlightedBlocks = highlighted;
+}
 
-    for (int i = 0; i < maze->get_row_num(); ++i)
-        for (int j = 0; j < maze->get_col_num(); ++j) {
-            if (!maze->isWall(i, j)) continue;
-            for (int _ = 0; _ < 5; ++_) {
-                shader->setMat4("model", wall_model[i][j][_].model);
-                shader->setMat3("model_res", wall_model[i][j][_].model_res);
-                wall_model[i][j][_].type = (gameState == 1 &&
-                        ((curPointAt[0] == i && curPointAt[1] == _ && curPointAt[2] == j) ||
-                        (markWall[0] == i && markWall[1] == _ && markWall[2] == j)))
-                                           ? "bedrock" : "stone";
-                models->at(wall_model[i][j][_].type).Draw(*shader);
-            }
-        }
+bool Application::isWallBlock(const int *cell) const {
+    return cell[0] >= 0 && cell[0] < maze->get_row_num() && cell[2] >= 0 && cell[2] < maze->get_col_num() &&
+           cell[1] >= 0 && cell[1] < 5 && maze->isWall(cell[0], cell[2]);
 }
 
 void Application::renderLight(glm::vec3 lightPos) {
@@ -455,11 +1083,26 @@ void Application::renderLight(glm::vec3 lightPos) {
     model = glm::translate(model,
                            lightPos);
     model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
-    lightCubeShader->setMat4("model", model);
-    characterBallUav->Draw(*lightCubeShader);
+    ObjectUniforms object{};
+    object.model = model;
+    stream->bindUniformBlock(OBJECT_BLOCK_BINDING, object);
+    characterBallUav->Draw(*lightCubeShader, modelLod(characterBallUav, model, sceneLod));
+}
+
+unsigned int Application::modelLod(const Model *model, const glm::mat4 &transform, const LodView &view) const {
+    // distance from the view's eye to the nearest point of the bounding sphere
+    float scale = glm::length(glm::vec3(transform[0]));
+    glm::vec3 center = glm::vec3(transform * glm::vec4(model->center, 1.0f));
+    float distance = std::max(glm::distance(center, view.eye) - model->radius * scale, view.nearest);
+    return model->selectLod(distance, scale, view.pixelsPerUnit, view.pixelError);
 }
 
 void Application::postRender() {
+    renderQueue->endFrame();
+    stream->endFrame();
+    // the back buffer is complete, HUD included
+    capture->endFrame(width, height, glfwGetTime());
+
     // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
     glfwSwapBuffers(m_window);
     glfwPollEvents();
@@ -521,16 +1164,11 @@ void Application::processInput() {
     // mark an object
     if (glfwGetKey(m_window, GLFW_KEY_E) == GLFW_PRESS) {
         if (gameState == 1 && glfwGetTime() - markJitterTime > 1) {
+            // mark that wall block, or cancel its mark; any number of them stay marked
             int *curPointAt = camera->getPointAt(maze, 2.);
-            if (curPointAt[0] == markWall[0] && curPointAt[1] == markWall[1] && curPointAt[2] == markWall[2]) {
-                // cancel marking
-                markWall[0] = markWall[1] = markWall[2] = -1;
-            } else {
-                // mark that wall
-                markWall[0] = curPointAt[0];
-                markWall[1] = curPointAt[1];
-                markWall[2] = curPointAt[2];
-            }
+            if (isWallBlock(curPointAt))
+                markRemoved = !marks->toggle(curPointAt[0], curPointAt[1], curPointAt[2]);
+            delete[] curPointAt;
         }
         markJitterTime = glfwGetTime();
     }
@@ -547,8 +1185,6 @@ void Application::processInput() {
         camera->moveAround(CameraMovement::UP, deltaTime, maze, 2.);
     if (glfwGetKey(m_window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
         camera->moveAround(CameraMovement::DOWN, deltaTime, maze, 2.);
-    if (glfwGetKey(m_window, GLFW_KEY_P) == GLFW_PRESS)
-        shadows = !shadows;
     // change moving speed
     if (glfwGetKey(m_window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
         camera->changeSpeed(SPEED_FAST_DEFAULT);
@@ -573,12 +1209,64 @@ void Application::mouseCallback(double xpos, double ypos) {
     this->camera->lookAround(xoffset, yoffset);
 }
 
-void Application::keyboardCallback(int key, int scancode, int action, int mods) {
-
+void Application::keyboardCallback(int key, int /*scancode*/, int action, int /*mods*/) {
+    if (action != GLFW_PRESS) return;
+    // toggle shadows, once per press rather than every frame the key is held
+    if (key == GLFW_KEY_P) {
+        shadows = !shadows;
+    }
+    // toggle GPU-driven block culling, where the context supports it
+    if (key == GLFW_KEY_C) {
+        gpuCulling = !gpuCulling;
+    }
+    // toggle the baked lightmap on the blocks, off shades the torches per fragment again
+    if (key == GLFW_KEY_L) {
+        bakedLighting = !bakedLighting;
+    }
+    // capture the window: a screenshot, or start / stop a recording
+    if (key == GLFW_KEY_F12) {
+        capture->screenshot();
+    }
+    if (key == GLFW_KEY_F9) {
+        capture->toggleRecording(CaptureFormat::Y4M);
+    }
+    if (key == GLFW_KEY_F10) {
+        capture->toggleRecording(CaptureFormat::PNG);
+    }
+    // toggle the UAV inset
+    if (key == GLFW_KEY_V) {
+        uavInset = !uavInset;
+        insetValid = false;
+    }
+    // toggle the depth pre-pass
+    if (key == GLFW_KEY_Z) {
+        depthPrepass = !depthPrepass;
+    }
+    // toggle the quality governor, off means full quality
+    if (key == GLFW_KEY_G) {
+        governorEnabled = !governorEnabled;
+        governor.reset();
+        applyQuality();
+    }
+    // switch shadow technique
+    if (key == GLFW_KEY_O) {
+        setShadowMode(shadowMode == ShadowMode::CUBEMAP ? ShadowMode::PARABOLOID :
+                      shadowMode == ShadowMode::PARABOLOID ? ShadowMode::GRID : ShadowMode::CUBEMAP);
+    }
+    // cycle the paraboloid map resolution, the governor keeps lowering it from there
+    if (key == GLFW_KEY_K) {
+        int count = sizeof(paraboloidResolutions) / sizeof(paraboloidResolutions[0]);
+        int next = 0;
+        for (int i = 0; i < count; ++i) {
+            if (paraboloidResolutions[i] == paraboloidChoice) next = (i + 1) % count;
+        }
+        paraboloidChoice = paraboloidResolutions[next];
+        applyParaboloidResolution();
+    }
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
-void Application::scrollCallback(double xoffset, double yoffset) {
+void Application::scrollCallback(double /*xoffset*/, double yoffset) {
     camera->zoom(yoffset);
 }
 
@@ -588,21 +1276,24 @@ void Application::framebufferSizeCallback(int width, int height) {
     lastX = width / 2.f;
     lastY = height / 2.f;
     glViewport(0, 0, width, height);
+    if (sceneFBO) resizeSceneTarget();
+    if (insetFBO) resizeInsetTarget();
+    if (hud) layoutHud();
 }
 
-void Application::CallbackWrapper::mouseCallback(GLFWwindow *window, double positionX, double positionY) {
+void Application::CallbackWrapper::mouseCallback(GLFWwindow *, double positionX, double positionY) {
     s_application->mouseCallback(positionX, positionY);
 }
 
-void Application::CallbackWrapper::keyboardCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+void Application::CallbackWrapper::keyboardCallback(GLFWwindow *, int key, int scancode, int action, int mods) {
     s_application->keyboardCallback(key, scancode, action, mods);
 }
 
-void Application::CallbackWrapper::scrollCallback(GLFWwindow *window, double xoffset, double yoffset) {
+void Application::CallbackWrapper::scrollCallback(GLFWwindow *, double xoffset, double yoffset) {
     s_application->scrollCallback(xoffset, yoffset);
 }
 
-void Application::CallbackWrapper::framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+void Application::CallbackWrapper::framebufferSizeCallback(GLFWwindow *, int width, int height) {
     s_application->framebufferSizeCallback(width, height);
 }
 
@@ -17,14 +17,48 @@
 #include <learnopengl/model.h>
 #include <sstream>
 
+#include "blocks.h"
+#include "capture.h"
+#include "frustum.h"
+#include "hud.h"
+#include "lightmap.h"
+#include "lights.h"
+#include "marks.h"
 #include "maze.h"
+#include "profiler.h"
+#include "program_cache.h"
+#include "quality_governor.h"
+#include "render_graph.h"
+#include "render_queue.h"
+#include "shader_variants.h"
+#include "shadow_mask.h"
+#include "stream_buffer.h"
 #include "text.h"
+#include "thread_pool.h"
+#include "uniforms.h"
+
+enum class ShadowMode {
+    CUBEMAP,     // six faces around the light, the original path
+    PARABOLOID,  // a single hemisphere looking down from the UAV
+    GRID         // the walls' shadows worked out on the maze grid, no depth pass at all
+};
 
 struct CubeModel {
-    string type;
     glm::vec3 position;
-    glm::mat4 model;
-    glm::mat3 model_res;
+    int instance;   // index into the block batch
+};
+
+struct ModelDraw {
+    Model *model;
+    glm::mat4 transform;
+    glm::mat3 normalMatrix;
+    unsigned int lod;
+};
+
+// everything one pass draws, prepared before any GL call of the frame
+struct PassList {
+    std::vector<ModelDraw> models;
+    std::vector<BlockInstance> blocks;
 };
 
 class Application {
@@ -37,8 +71,9 @@ public:
     static void init() {
         // glfw: initialize and configure
         glfwInit();
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        // 4.6 for the GPU-driven paths, the constructor falls back to 3.3
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
@@ -52,10 +87,28 @@ public:
 
     void render();
 
-    void renderObject(Shader *);
+    // insetViewProjection is the UAV's when the inset is drawn this frame, null otherwise
+    void prepareFrame(const glm::mat4 &viewProjection, glm::vec3 lightPos, const glm::mat4 *insetViewProjection);
+
+    // features are the frame's, the block batch adds INSTANCED and, when textured, TEXTURE_ARRAY
+    void renderObject(ShaderVariants *, RenderPass pass, unsigned features = 0);
+
+    // the same from a list prepareFrame() collected and the block batch's cull slot that goes with it
+    void renderObject(ShaderVariants *, RenderPass pass, unsigned features, const PassList &list, int cullSlot);
 
     void renderLight(glm::vec3);
 
+    void updateBlockHighlights();
+
+    // a (row, layer, col) from Camera::getPointAt that names a wall block
+    bool isWallBlock(const int *cell) const;
+
+    void setShadowMode(ShadowMode mode) { shadowMode = mode; }
+
+    void setParaboloidResolution(GLuint size);
+
+    void setShadowResolution(GLuint size);
+
     void postRender();
 
     bool shouldClose() { return glfwWindowShouldClose(m_window); }
@@ -63,6 +116,9 @@ public:
     bool alive() { return !shouldClose(); }
 
     int terminate() {
+        // the last captured frames are written while the context still exists
+        delete capture;
+        capture = nullptr;
         glfwDestroyWindow(m_window);
         glfwTerminate();
         return 0;
@@ -77,6 +133,29 @@ private:
     int width, height;
     GLuint SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
 
+    // frame time budget held by scaling the scene, the shadow maps and their update rate; G toggles it
+    QualityGovernor governor = QualityGovernor(1000.0 / 60.0);
+    bool governorEnabled = true;
+    GpuTimer *sceneTimer;
+    double frameStartTime = 0.0;
+    unsigned long frameIndex = 0;
+    // the scene is drawn here below full scale and upscaled to the window, the HUD stays sharp
+    GLuint sceneFBO = 0, sceneColor = 0, sceneDepth = 0;
+    int sceneWidth, sceneHeight;
+
+    // the UAV's view in a corner of the window while the adventurer plays, V toggles it. Its list is
+    // culled against the UAV's frustum along with the frame's, into a cull slot of its own; it is drawn
+    // at a fraction of its size on screen and only every INSET_INTERVAL frames, the frames in between
+    // show the last one again
+    bool uavInset = true;
+    const unsigned INSET_INTERVAL = 2;
+    const float INSET_SIZE = 0.25f, INSET_SCALE = 0.5f;  // of the window, of the inset on screen
+    GLuint insetFBO = 0, insetColor = 0, insetDepth = 0;
+    int insetWidth = 1, insetHeight = 1;
+    bool insetValid = false;    // holds a view rendered since the last resize
+    PassList insetList;
+    const int INSET_CULL_SLOT = 2;  // the block batch's slots 0 and 1 belong to the passes
+
     float lastX, lastY;
     float deltaTime, lastFrame;
     bool firstMouse = true;
@@ -90,13 +169,68 @@ private:
     Camera camera_adventurer = Camera(CAM_POS_DEFAULT, WORLD_UP_DEFAULT, TARGET_POS_DEFAULT, true);
     Camera camera_uav = Camera(CAM_POS_DEFAULT, WORLD_UP_DEFAULT, TARGET_POS_DEFAULT, false);
     Camera *camera;
-    Model *characterBallAdv;
-    Model *characterBallUav;
+    Model *characterBallAdv = nullptr;
+    Model *characterBallUav = nullptr;
+
+    // screen error a LOD may introduce, in pixels; shadows tolerate a coarser mesh
+    const float LOD_PIXEL_ERROR = 1.0f, SHADOW_LOD_PIXEL_ERROR = 4.0f;
+    // where a list's models are seen from, for picking their LOD
+    struct LodView {
+        glm::vec3 eye;
+        float pixelsPerUnit;    // at distance 1
+        float nearest;          // distances are clamped to the near plane
+        float pixelError;
+    };
+    LodView sceneLod{}, shadowLod{}, insetLod{};
 
+    const GLfloat SHADOW_NEAR = 1.0f;
     GLuint depthMapFBO;
     GLuint depthCubeMap;
 
-    FreeType *freeType;
+    ShadowMode shadowMode = ShadowMode::CUBEMAP;
+    GLuint PARABOLOID_SIZE = 1024;
+    GLuint paraboloidChoice = 1024;     // picked with K, the size at full quality that the governor scales down
+    GLuint paraboloidFBO = 0;
+    GLuint paraboloidMap = 0;
+    GpuTimer *shadowTimers[2];  // the depth pass of CUBEMAP and PARABOLOID, each only timed while active
+    ShadowMask *shadowMask = nullptr;
+
+    // every per-frame upload goes through here: uniform blocks, transforms, HUD vertices, light grid
+    const GLsizeiptr STREAM_FRAME_SIZE = 1 << 20;
+    StreamBuffer *stream;
+
+    RenderQueue *renderQueue;
+
+    // frame preparation fans out over the pool, the GL thread only submits the lists
+    ThreadPool *threadPool;
+    PassList passLists[2];  // indexed by RenderPass, the depth pre-pass reuses the opaque list
+    // blocks culled by a compute shader into the batch's slot of each pass list instead, C toggles
+    bool gpuCulling = true;
+    float lightReach = 0.0f;    // distance at which the UAV light's attenuation falls below 1/256
+
+    // declared every frame, Z toggles the depth pre-pass
+    RenderGraph renderGraph;
+    bool depthPrepass = true;
+
+    // torches along the corridors and glowing collectibles, shaded per maze cell
+    LightGrid *lightGrid = nullptr;
+    std::vector<PointLight> torches;
+    // occlusion and torch light of the block faces, baked at level load; L toggles it
+    Lightmap *lightmap = nullptr;
+    bool bakedLighting = true;
+
+    // screenshots (F12) and recordings (F9 y4m, F10 PNG sequence) read back without stalling the frame
+    FrameCapture *capture = nullptr;
+
+    FreeType *freeType = nullptr;
+
+    Hud *hud = nullptr;
+    struct {
+        int fps, state, shadow, queue, stream, quality, graph, time, cursor, help[4], mode, things[3], go, win, level, markRemoved, marked, capture;
+    } hudLabels;
+    // FPS and pass timings would otherwise change the HUD every frame
+    const double HUD_STATS_INTERVAL = 0.25;
+    double hudStatsTime = 0.0;
 
     int gameLevel = 1;
     double levelTime = 0.0;
@@ -113,11 +247,21 @@ private:
 
     double markJitterTime = 0.0;
 
-    int* markWall;
+    // every marked wall block, E toggles the one pointed at
+    MarkGrid *marks = nullptr;
+    bool markRemoved = false;   // the last toggle cleared a mark
 
-    Shader *lightCubeShader, *objShader, *depthShader;
+    Shader *lightCubeShader = nullptr;
+    // feature permutations of the scene and depth programs, compiled as the frame asks for them
+    ShaderVariants *objShaders = nullptr, *depthShaders = nullptr, *paraboloidShaders = nullptr,
+            *prepassShaders = nullptr;
+    ProgramCache *programCache = nullptr;
 
-    map<string, Model> *models;
+    Model *blockModel = nullptr;
+    BlockTextureArray *blockTextures = nullptr;
+    BlockBatch *blockBatch = nullptr;
+    int bedrockLayer;
+    std::vector<int> highlightedBlocks;
 
     Maze *maze;
 
@@ -127,12 +271,44 @@ private:
     bool shadows = true;
     bool winOrNot = false;
 
-    Model* collection;
+    Model* collection = nullptr;
 
     bool reachReg(glm::vec3 cen1, glm::vec3 cen2);
 
     void processInput();
 
+    unsigned int modelLod(const Model *model, const glm::mat4 &transform, const LodView &view) const;
+
+    void initHud();
+
+    void layoutHud();
+
+    void updateHud();
+
+    void updateLightBlock(glm::vec3 lightPos, GLfloat far);
+
+    void resizeSceneTarget();
+
+    void resizeInsetTarget();
+
+    bool insetVisible() const { return uavInset && adventurer_handle; }
+
+    void bindSceneTextures();
+
+    void applyQuality();
+
+    void applyParaboloidResolution();
+
+    void placeTorches();
+
+    void updateLights();
+
+    void bakeLightmap();
+
+    void renderShadowCubeMap();
+
+    void renderShadowParaboloid();
+
     void framebufferSizeCallback(int width, int height);
 
     void mouseCallback(double positionX, double positionY);
@@ -0,0 +1,252 @@
+//
+// Created by light on 10/18/2026.
+//
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#include <stb_image.h>
+
+#include "blocks.h"
+#include "glext.h"
+
+// Per-instance attribute location in objShader.vs and the depth shaders
+static const int INSTANCE_ATTRIBUTE = 5;
+// instances culled per task, enough to amortise the hand-off
+static const size_t PACK_GRAIN = 2048;
+// local_size_x of cull_blocks.comp
+static const GLuint CULL_GROUP_SIZE = 64;
+
+BlockTextureArray::BlockTextureArray(const std::string &directory, const std::vector<std::string> &first) {
+    std::vector<std::string> files;
+    for (const std::string &name : first) {
+        files.push_back(name);
+    }
+    std::vector<std::string> rest;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() != ".png") continue;
+        std::string name = entry.path().stem().string();
+        if (std::find(first.begin(), first.end(), name) == first.end()) {
+            rest.push_back(name);
+        }
+    }
+    // directory order is unspecified, keep the layers stable between runs
+    std::sort(rest.begin(), rest.end());
+    files.insert(files.end(), rest.begin(), rest.end());
+
+    std::vector<unsigned char> pixels;
+    for (const std::string &name : files) {
+        std::string filename = directory + "/" + name + ".png";
+        int width, height, nrComponents;
+        unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 4);
+        if (!data) {
+            std::cout << "Texture failed to load at path: " << filename << std::endl;
+            continue;
+        }
+        // all layers share the size of the first texture; animated strips keep their first frame
+        if (size == 0) size = width;
+        if (width != size || height < size) {
+            std::cout << "Skipping block texture " << name << ": " << width << "x" << height
+                      << " does not fit the " << size << "x" << size << " array" << std::endl;
+            stbi_image_free(data);
+            continue;
+        }
+        pixels.insert(pixels.end(), data, data + size * size * 4);
+        int layer = (int) names.size();
+        names[name] = layer;
+        stbi_image_free(data);
+    }
+
+    glGenTextures(1, &ID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, (GLsizei) names.size(), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+int BlockTextureArray::layer(const std::string &name) const {
+    auto it = names.find(name);
+    return it == names.end() ? -1 : it->second;
+}
+
+BlockBatch::BlockBatch(const Mesh &mesh, const BlockTextureArray &textures, StreamBuffer *stream)
+        : mesh(mesh), textures(textures), stream(stream) {
+    // a vertex array of its own over the arena's buffers carries the instance stream, so the
+    // models sharing the arena's array never see it; draw() points the attribute at wherever
+    // this frame's instances were written
+    VAO = mesh.arena->createVertexArray();
+    glBindVertexArray(VAO);
+    glEnableVertexAttribArray(INSTANCE_ATTRIBUTE);
+    glVertexAttribDivisor(INSTANCE_ATTRIBUTE, 1);
+    glBindVertexArray(0);
+
+    if (glDispatchCompute && glMemoryBarrier && glMultiDrawElementsIndirect) {
+        cullShader = new ComputeShader("res/cull_blocks.comp");
+        glGenBuffers(1, &residentBuffer);
+        glGenBuffers(CULL_SLOTS, visibleBuffers);
+        glGenBuffers(CULL_SLOTS, commandBuffers);
+        for (GLuint buffer : commandBuffers) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+}
+
+BlockBatch::~BlockBatch() {
+    if (!cullShader) return;
+    glDeleteProgram(cullShader->ID);
+    delete cullShader;
+    glDeleteBuffers(1, &residentBuffer);
+    glDeleteBuffers(CULL_SLOTS, visibleBuffers);
+    glDeleteBuffers(CULL_SLOTS, commandBuffers);
+}
+
+void BlockBatch::clear() {
+    instances.clear();
+    baseLayers.clear();
+    resident = false;
+}
+
+int BlockBatch::add(glm::vec3 position, int layer) {
+    instances.push_back(BlockInstance{position, (float) layer});
+    baseLayers.push_back(layer);
+    resident = false;
+    return (int) instances.size() - 1;
+}
+
+void BlockBatch::setLayer(int instance, int layer) {
+    if (instances[instance].layer == (float) layer) return;
+    instances[instance].layer = (float) layer;
+    if (!cullShader || !resident) return;
+    changed.push_back(instance);
+    // while cull() is not being called, past a few dozen changes a full upload is cheaper anyway
+    if (changed.size() > 64) {
+        resident = false;
+        changed.clear();
+    }
+}
+
+void BlockBatch::pack(ThreadPool &pool, const Frustum *frustum, glm::vec3 origin, float maxDistance,
+                      std::vector<BlockInstance> &out) {
+    // a block fills its 2x2x2 cell
+    const glm::vec3 extent(1.0f);
+    float reach = maxDistance + glm::length(extent);
+    // every chunk fills its own list, concatenated in order afterwards so the result does not
+    // depend on the thread count
+    chunks.resize((instances.size() + PACK_GRAIN - 1) / PACK_GRAIN);
+    pool.parallelFor(instances.size(), PACK_GRAIN, [&](size_t begin, size_t end) {
+        std::vector<BlockInstance> &visible = chunks[begin / PACK_GRAIN];
+        visible.clear();
+        for (size_t i = begin; i < end; ++i) {
+            if (frustum && !frustum->intersectsBox(instances[i].position, extent)) continue;
+            if (glm::distance(instances[i].position, origin) > reach) continue;
+            visible.push_back(instances[i]);
+        }
+    });
+
+    out.clear();
+    for (const std::vector<BlockInstance> &visible : chunks)
+        out.insert(out.end(), visible.begin(), visible.end());
+}
+
+void BlockBatch::draw(bool textured, const std::vector<BlockInstance> &packed) const {
+    if (packed.empty()) return;
+    GLintptr offset = stream->write(packed.data(), packed.size() * sizeof(BlockInstance), sizeof(BlockInstance));
+
+    bindTextures(textured);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer());
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(BlockInstance), (void *) offset);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.lod(0).count, mesh.indexType, (void *) mesh.lodOffset(0),
+                                      (GLsizei) packed.size(), mesh.range.baseVertex);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void BlockBatch::bindTextures(bool textured) const {
+    if (!textured) return;
+    glActiveTexture(GL_TEXTURE0 + BLOCK_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textures.ID);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void BlockBatch::uploadResident() {
+    GLsizeiptr size = (GLsizeiptr) (std::max<size_t>(instances.size(), 1) * sizeof(BlockInstance));
+    if (instances.size() > capacity || capacity == 0) {
+        // a new level: size every buffer for the whole maze once
+        capacity = std::max<size_t>(instances.size(), 1);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, residentBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, instances.data(), GL_STATIC_DRAW);
+        for (GLuint buffer : visibleBuffers) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+        }
+    } else {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, residentBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr) (instances.size() * sizeof(BlockInstance)),
+                        instances.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    resident = true;
+}
+
+void BlockBatch::cull(int slot, const Frustum *frustum, glm::vec3 origin, float maxDistance) {
+    if (!resident) {
+        uploadResident();
+        changed.clear();
+    }
+    if (!changed.empty()) {
+        // a highlight changes a block or two, not worth re-sending the maze
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, residentBuffer);
+        for (int instance : changed)
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, instance * sizeof(BlockInstance), sizeof(BlockInstance),
+                            &instances[instance]);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        changed.clear();
+    }
+
+    // the shader counts the visible instances up from zero
+    DrawElementsIndirectCommand command{};
+    command.count = mesh.lod(0).count;
+    command.firstIndex = mesh.range.firstIndex + mesh.lod(0).first;
+    command.baseVertex = mesh.range.baseVertex;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffers[slot]);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glm::vec4 planes[6];
+    for (int i = 0; i < 6; ++i)
+        planes[i] = frustum ? frustum->planes[i] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    cullShader->use();
+    cullShader->setUInt("instanceTotal", (GLuint) instances.size());
+    cullShader->setVec4Array("planes", planes, 6);
+    cullShader->setVec4("cullSphere", glm::vec4(origin, maxDistance));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, residentBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleBuffers[slot]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffers[slot]);
+    glDispatchCompute(((GLuint) instances.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    // the draws read the list as vertex attributes and the count as their command
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void BlockBatch::drawCulled(int slot, bool textured) const {
+    bindTextures(textured);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, visibleBuffers[slot]);
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(BlockInstance), nullptr);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffers[slot]);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, mesh.indexType, nullptr, 1, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
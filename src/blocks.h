@@ -0,0 +1,123 @@
+//
+// Created by light on 10/18/2026.
+//
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/compute_shader.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include "frustum.h"
+#include "stream_buffer.h"
+#include "thread_pool.h"
+
+// Block textures are sampled through unit 4, units 0-3 belong to the material and the shadow maps
+const int BLOCK_TEXTURE_UNIT = 4;
+
+// Every block texture of res/assets/textures/blocks in one GL_TEXTURE_2D_ARRAY,
+// so all block types share a single material and pick their look by layer.
+class BlockTextureArray {
+public:
+    unsigned int ID;
+
+    // the textures named in `first` get the lowest layers, in that order
+    BlockTextureArray(const std::string &directory, const std::vector<std::string> &first);
+
+    // layer of a texture by file name without extension, -1 if it was not loaded
+    int layer(const std::string &name) const;
+
+    int layerCount() const { return (int) names.size(); }
+
+private:
+    int size = 0;
+    std::map<std::string, int> names;
+};
+
+struct BlockInstance {
+    glm::vec3 position;
+    float layer;
+};
+
+// All cubes of the level drawn with one instanced call. Each instance carries
+// its offset and texture layer, so highlighting a block only changes a layer
+// instead of switching model and texture. Every pass packs the instances it
+// needs on the worker threads and streams just those to the GPU.
+//
+// With GL 4.3 compute shaders and multi-draw-indirect there is a GPU-driven
+// path instead: the instances stay resident in a storage buffer, cull() has a
+// compute shader append the visible ones to a per-slot list and count them
+// into an indirect command, and drawCulled() draws that list without the CPU
+// ever looking at a single block.
+class BlockBatch {
+public:
+    // independent cull results, one per pass that culls differently and one for the UAV inset
+    static const int CULL_SLOTS = 3;
+
+    BlockBatch(const Mesh &mesh, const BlockTextureArray &textures, StreamBuffer *stream);
+
+    ~BlockBatch();
+
+    BlockBatch(const BlockBatch &) = delete;
+
+    BlockBatch &operator=(const BlockBatch &) = delete;
+
+    void clear();
+
+    // returns the instance index, valid until the next clear()
+    int add(glm::vec3 position, int layer);
+
+    // change the texture of a single block, seen by the next pack() or cull()
+    void setLayer(int instance, int layer);
+
+    // the layer the block was added with
+    int baseLayer(int instance) const { return baseLayers[instance]; }
+
+    size_t size() const { return instances.size(); }
+
+    // copy the instances inside the frustum (if any) and within maxDistance of origin into out, in
+    // parallel; the same test cull() runs on the GPU
+    void pack(ThreadPool &pool, const Frustum *frustum, glm::vec3 origin, float maxDistance,
+              std::vector<BlockInstance> &out);
+
+    // stream a packed instance list and draw it with the bound program, an INSTANCED variant
+    void draw(bool textured, const std::vector<BlockInstance> &packed) const;
+
+    bool gpuCulling() const { return cullShader != nullptr; }
+
+    // cull every instance on the GPU into a slot: inside the frustum (if any) and
+    // within maxDistance of origin; only call when gpuCulling()
+    void cull(int slot, const Frustum *frustum, glm::vec3 origin, float maxDistance);
+
+    // draw a slot's visible instances with one indirect call, like draw()
+    void drawCulled(int slot, bool textured) const;
+
+private:
+    const Mesh &mesh;
+    GLuint VAO;                         // the mesh's arena buffers plus the instance attribute
+    const BlockTextureArray &textures;
+    StreamBuffer *stream;
+
+    std::vector<BlockInstance> instances;
+    std::vector<int> baseLayers;
+    std::vector<std::vector<BlockInstance>> chunks;     // pack() output of each chunk, kept between frames
+
+    // GPU-driven path
+    ComputeShader *cullShader = nullptr;
+    GLuint residentBuffer = 0;          // every instance
+    GLuint visibleBuffers[CULL_SLOTS]{};
+    GLuint commandBuffers[CULL_SLOTS]{};
+    size_t capacity = 0;                // instances the buffers have room for
+    bool resident = false;              // false after add()/clear(), the next cull() uploads everything
+    std::vector<int> changed;           // setLayer() calls since the last cull()
+
+    void uploadResident();
+
+    void bindTextures(bool textured) const;
+};
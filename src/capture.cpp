@@ -0,0 +1,296 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+#include <stb_image_write.h>
+
+#include "capture.h"
+
+static uint8_t toByte(float value) {
+    return (uint8_t) std::min(255.0f, std::max(0.0f, value + 0.5f));
+}
+
+FrameCapture::Sink::~Sink() {
+    if (file) fclose(file);
+}
+
+FrameCapture::FrameCapture(std::string directory, double framesPerSecond)
+        : directory(std::move(directory)), interval(1.0 / framesPerSecond) {
+    for (Slot &slot : slots)
+        glGenBuffers(1, &slot.buffer);
+    // rows come bottom first from GL; a recording favours encoding speed over file size
+    stbi_flip_vertically_on_write(1);
+    stbi_write_png_compression_level = 3;
+    encoder = std::thread(&FrameCapture::encode, this);
+}
+
+FrameCapture::~FrameCapture() {
+    while (inFlight > 0)
+        collect(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    encoder.join();
+    for (Slot &slot : slots)
+        glDeleteBuffers(1, &slot.buffer);
+}
+
+std::string FrameCapture::timestamp() const {
+    auto now = std::chrono::system_clock::now();
+    std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y%m%d-%H%M%S", std::localtime(&seconds));
+    char suffix[8];
+    std::snprintf(suffix, sizeof(suffix), "-%03d", (int) millis);
+    return std::string(text) + suffix;
+}
+
+bool FrameCapture::prepareDirectory() const {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cout << "ERROR::CAPTURE::DIRECTORY_NOT_CREATED " << directory << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void FrameCapture::screenshot() {
+    if (!prepareDirectory()) return;
+    screenshotSink = std::make_shared<Sink>();
+    screenshotSink->format = CaptureFormat::PNG;
+    screenshotSink->sequence = false;
+    screenshotSink->path = directory + "/" + timestamp() + ".png";
+}
+
+void FrameCapture::toggleRecording(CaptureFormat format) {
+    if (recordingSink) {
+        std::cout << "Recording " << recordingSink->path << ": " << captured << " frames, " << dropped
+                  << " dropped" << std::endl;
+        // the frames still in flight keep the sink open until the encoder has written them
+        recordingSink.reset();
+        return;
+    }
+    if (!prepareDirectory()) return;
+    auto sink = std::make_shared<Sink>();
+    sink->format = format;
+    sink->sequence = true;
+    sink->rate = (int) std::lround(1.0 / interval);
+    sink->path = directory + "/" + timestamp() + (format == CaptureFormat::Y4M ? ".y4m" : "");
+    if (format == CaptureFormat::PNG) {
+        std::error_code error;
+        std::filesystem::create_directories(sink->path, error);
+        if (error) {
+            std::cout << "ERROR::CAPTURE::DIRECTORY_NOT_CREATED " << sink->path << ": " << error.message() << std::endl;
+            return;
+        }
+    }
+    recordingSink = sink;
+    captured = dropped = 0;
+    recordingStart = -1.0;
+    lastIndex = -1;
+}
+
+void FrameCapture::endFrame(int width, int height, double now) {
+    // hand on every readback that finished, in order, without waiting for one that has not
+    while (inFlight > 0 && collect(false));
+
+    if (width <= 0 || height <= 0) return;
+    // a screenshot waits for a free slot rather than getting lost
+    if (screenshotSink && inFlight < RING) {
+        readBack(width, height, std::move(screenshotSink), 0);
+        screenshotSink.reset();
+    }
+    // recordings sample the frames at their own rate: the frame nearest each slot interval apart,
+    // a slot no frame fell into is filled by the encoder
+    if (recordingSink) {
+        if (recordingStart < 0.0) recordingStart = now;
+        long index = std::lround((now - recordingStart) / interval);
+        if (index <= lastIndex) return;
+        lastIndex = index;
+        if (inFlight == RING) {
+            ++dropped;
+            return;
+        }
+        readBack(width, height, recordingSink, index);
+        ++captured;
+    }
+}
+
+void FrameCapture::readBack(int width, int height, std::shared_ptr<Sink> sink, long index) {
+    Slot &slot = slots[next];
+    auto size = (GLsizeiptr) width * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.capacity < size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+    }
+    // into the buffer, glReadPixels returns as soon as the copy is queued; a 3 byte format would
+    // have the driver convert every pixel on the CPU first
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.index = index;
+    slot.sink = std::move(sink);
+    next = (next + 1) % RING;
+    ++inFlight;
+}
+
+bool FrameCapture::collect(bool wait) {
+    Slot &slot = slots[oldest];
+    GLenum status = glClientWaitSync(slot.fence, 0, 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    bool full;
+    Frame frame{slot.sink, slot.width, slot.height, slot.index, {}};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        full = queue.size() >= MAX_QUEUED;
+        // a buffer the encoder has finished with already has the room, no allocation per frame
+        if (!full && !spare.empty()) {
+            frame.pixels = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+    if ((full && slot.sink->sequence) || status == GL_WAIT_FAILED) {
+        // the encoder is behind, a recording loses the frame rather than the game its frame rate
+        ++dropped;
+    } else {
+        auto size = (GLsizeiptr) slot.width * slot.height * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        auto *pixels = (const uint8_t *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        bool mapped = pixels != nullptr;
+        if (mapped) {
+            frame.pixels.resize((size_t) size);
+            std::memcpy(frame.pixels.data(), pixels, (size_t) size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (mapped) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(std::move(frame));
+            }
+            wake.notify_one();
+        }
+    }
+    slot.sink.reset();
+    oldest = (oldest + 1) % RING;
+    --inFlight;
+    return true;
+}
+
+void FrameCapture::encode() {
+    for (;;) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        write(*frame.sink, frame);
+        // the last frame of a sink closes its file here, off the GL thread
+        frame.sink.reset();
+        std::lock_guard<std::mutex> lock(mutex);
+        spare.push_back(std::move(frame.pixels));
+    }
+}
+
+void FrameCapture::write(Sink &sink, const Frame &frame) {
+    if (sink.format == CaptureFormat::PNG) {
+        std::string path = sink.path;
+        if (sink.sequence) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "/frame_%05u.png", sink.frames);
+            path += name;
+        }
+        // BGRA to RGB, the back buffer's alpha is not meant to be seen
+        size_t pixelCount = (size_t) frame.width * frame.height;
+        rgb.resize(pixelCount * 3);
+        for (size_t i = 0; i < pixelCount; ++i) {
+            rgb[i * 3] = frame.pixels[i * 4 + 2];
+            rgb[i * 3 + 1] = frame.pixels[i * 4 + 1];
+            rgb[i * 3 + 2] = frame.pixels[i * 4];
+        }
+        if (!stbi_write_png(path.c_str(), frame.width, frame.height, 3, rgb.data(), frame.width * 3))
+            std::cout << "ERROR::CAPTURE::PNG_NOT_WRITTEN " << path << std::endl;
+        ++sink.frames;
+        return;
+    }
+
+    // 4:2:0 needs even sizes, and a stream keeps the size of its first frame
+    if (!sink.file) {
+        sink.file = std::fopen(sink.path.c_str(), "wb");
+        if (!sink.file) {
+            std::cout << "ERROR::CAPTURE::FILE_NOT_OPENED " << sink.path << std::endl;
+            return;
+        }
+        sink.width = frame.width & ~1;
+        sink.height = frame.height & ~1;
+        std::fprintf(sink.file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", sink.width, sink.height, sink.rate);
+    }
+    if (frame.width < sink.width || frame.height < sink.height)
+        return;
+
+    // the slots between the last frame and this one show the last frame again, a stream that
+    // declares a rate has to have a frame for every one of them
+    std::vector<uint8_t> &planes = sink.planes;
+    for (; sink.frames < (unsigned) frame.index && !planes.empty(); ++sink.frames) {
+        std::fputs("FRAME\n", sink.file);
+        std::fwrite(planes.data(), 1, planes.size(), sink.file);
+    }
+    sink.frames = std::max(sink.frames, (unsigned) frame.index);
+
+    // full range BT.601, chroma averaged over 2x2 pixels; the top row is the last one GL returned
+    int w = sink.width, h = sink.height;
+    planes.resize((size_t) w * h * 3 / 2);
+    uint8_t *y = planes.data(), *u = y + (size_t) w * h, *v = u + (size_t) w * h / 4;
+    auto pixel = [&](int px, int py) { return &frame.pixels[((size_t) (frame.height - 1 - py) * frame.width + px) * 4]; };
+    for (int py = 0; py < h; ++py)
+        for (int px = 0; px < w; ++px) {
+            const uint8_t *bgra = pixel(px, py);
+            y[(size_t) py * w + px] = toByte(0.299f * bgra[2] + 0.587f * bgra[1] + 0.114f * bgra[0]);
+        }
+    for (int py = 0; py < h; py += 2)
+        for (int px = 0; px < w; px += 2) {
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                const uint8_t *bgra = pixel(px + (k & 1), py + (k >> 1));
+                r += bgra[2];
+                g += bgra[1];
+                b += bgra[0];
+            }
+            r *= 0.25f;
+            g *= 0.25f;
+            b *= 0.25f;
+            size_t c = (size_t) (py / 2) * (w / 2) + px / 2;
+            u[c] = toByte(-0.168736f * r - 0.331264f * g + 0.5f * b + 128.0f);
+            v[c] = toByte(0.5f * r - 0.418688f * g - 0.081312f * b + 128.0f);
+        }
+    std::fputs("FRAME\n", sink.file);
+    std::fwrite(planes.data(), 1, planes.size(), sink.file);
+    ++sink.frames;
+}
@@ -0,0 +1,129 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+enum class CaptureFormat {
+    PNG,    // a numbered PNG per frame in a directory of its own
+    Y4M     // one uncompressed YUV 4:2:0 stream
+};
+
+// Screenshots and recordings of the window without stalling the frame. The
+// back buffer is read as BGRA, the layout drivers copy without converting,
+// into one of a ring of pixel buffer objects and fenced; a later frame maps
+// the buffer once its fence has signalled and copies the pixels into a
+// pooled buffer for an encoder thread, which converts and writes the files.
+// When the ring or the encoder's queue is full the capture drops the frame,
+// never the game; a y4m stream repeats the frame before in its place so it
+// still plays back in real time.
+class FrameCapture {
+public:
+    // frames in flight between the GPU and the encoder
+    static const int RING = 3;
+    static const size_t MAX_QUEUED = 8;
+
+    // captures go to directory, created when the first one starts
+    explicit FrameCapture(std::string directory = "captures", double framesPerSecond = 60.0);
+
+    // waits for the frames in flight and the encoder to write them
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture &) = delete;
+
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    // the next frame as a PNG
+    void screenshot();
+
+    // start a recording, or stop the one running
+    void toggleRecording(CaptureFormat format);
+
+    bool recording() const { return (bool) recordingSink; }
+
+    // after the last draw of the frame and before the swap: read it back if a capture wants it,
+    // and pass the frames whose readback finished on to the encoder
+    void endFrame(int width, int height, double now);
+
+    // frames of the running or last recording, taken and dropped
+    unsigned framesCaptured() const { return captured; }
+
+    unsigned framesDropped() const { return dropped; }
+
+private:
+    // where the frames of one screenshot or recording go, closed after its last frame is written
+    struct Sink {
+        CaptureFormat format;
+        std::string path;   // the PNG itself for a screenshot, else the directory or the y4m file
+        bool sequence;
+        int rate = 60;      // frames per second a y4m stream declares
+        FILE *file = nullptr;
+        unsigned frames = 0;    // written so far, for a y4m stream also the next slot it fills
+        int width = 0, height = 0;
+        std::vector<uint8_t> planes;    // the last y4m frame, repeated for the slots no frame arrived for
+
+        ~Sink();
+    };
+
+    struct Slot {
+        GLuint buffer = 0;
+        GLsizeiptr capacity = 0;
+        GLsync fence = nullptr;
+        int width = 0, height = 0;
+        long index = 0;
+        std::shared_ptr<Sink> sink;
+    };
+
+    struct Frame {
+        std::shared_ptr<Sink> sink;
+        int width, height;
+        long index;                     // the recording's slot, interval apart from its first frame
+        std::vector<uint8_t> pixels;    // BGRA, bottom row first
+    };
+
+    std::string directory;
+    double interval;
+
+    Slot slots[RING];
+    int next = 0, oldest = 0, inFlight = 0;
+
+    std::shared_ptr<Sink> screenshotSink, recordingSink;
+    double recordingStart = -1.0;   // time of the first frame, negative until it is taken
+    long lastIndex = -1;
+    unsigned captured = 0, dropped = 0;
+
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Frame> queue;
+    std::vector<std::vector<uint8_t>> spare;    // pixel buffers the encoder is done with, for reuse
+    bool stopping = false;
+    std::vector<uint8_t> rgb;       // the encoder's conversion of a frame for stb_image_write
+
+    std::string timestamp() const;
+
+    bool prepareDirectory() const;
+
+    void readBack(int width, int height, std::shared_ptr<Sink> sink, long index);
+
+    // map the oldest slot, wait tells whether its fence may be waited for
+    bool collect(bool wait);
+
+    void encode();
+
+    // on the encoder thread
+    void write(Sink &sink, const Frame &frame);
+};
@@ -0,0 +1,42 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// The six planes of a view-projection matrix, normals pointing inwards, for
+// conservative visibility tests of boxes and spheres.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4 &viewProjection) {
+        // Gribb-Hartmann: each plane is the fourth row plus or minus one of the others
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; ++i)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        for (int i = 0; i < 3; ++i) {
+            planes[i * 2] = rows[3] + rows[i];
+            planes[i * 2 + 1] = rows[3] - rows[i];
+        }
+        for (glm::vec4 &plane : planes)
+            plane /= glm::length(glm::vec3(plane));
+    }
+
+    // axis aligned box given by its centre and half size
+    bool intersectsBox(const glm::vec3 &center, const glm::vec3 &extent) const {
+        for (const glm::vec4 &plane : planes) {
+            glm::vec3 normal(plane);
+            float reach = glm::dot(glm::abs(normal), extent);
+            if (glm::dot(normal, center) + plane.w < -reach) return false;
+        }
+        return true;
+    }
+
+    bool intersectsSphere(const glm::vec3 &center, float radius) const {
+        for (const glm::vec4 &plane : planes)
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+        return true;
+    }
+};
@@ -0,0 +1,56 @@
+//
+// Created by light on 10/18/2026.
+//
+
+#include <cstring>
+
+#include "glext.h"
+
+PFNGLVERTEXATTRIBDIVISORPROC glad_glVertexAttribDivisor = nullptr;
+PFNGLGETQUERYOBJECTUI64VPROC glad_glGetQueryObjectui64v = nullptr;
+PFNGLGETPROGRAMBINARYPROC glad_glGetProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC glad_glProgramBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC glad_glProgramParameteri = nullptr;
+PFNGLTEXBUFFERRANGEPROC glad_glTexBufferRange = nullptr;
+PFNGLBUFFERSTORAGEPROC glad_glBufferStorage = nullptr;
+PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute = nullptr;
+PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier = nullptr;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect = nullptr;
+
+bool hasGLFeature(int major, int minor, const char *extension) {
+    if (GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor))
+        return true;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        auto name = (const char *) glGetStringi(GL_EXTENSIONS, i);
+        if (name && std::strcmp(name, extension) == 0)
+            return true;
+    }
+    return false;
+}
+
+void loadGLExtensions(GLADloadproc load) {
+    glad_glVertexAttribDivisor = (PFNGLVERTEXATTRIBDIVISORPROC) load("glVertexAttribDivisor");
+    if (!glad_glVertexAttribDivisor)
+        glad_glVertexAttribDivisor = (PFNGLVERTEXATTRIBDIVISORPROC) load("glVertexAttribDivisorARB");
+    glad_glGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC) load("glGetQueryObjectui64v");
+    // drivers hand out pointers for entry points the context does not support, ask first
+    if (hasGLFeature(4, 1, "GL_ARB_get_program_binary")) {
+        glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC) load("glGetProgramBinary");
+        glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC) load("glProgramBinary");
+        glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC) load("glProgramParameteri");
+    }
+    if (hasGLFeature(4, 3, "GL_ARB_texture_buffer_range"))
+        glad_glTexBufferRange = (PFNGLTEXBUFFERRANGEPROC) load("glTexBufferRange");
+    if (hasGLFeature(4, 4, "GL_ARB_buffer_storage"))
+        glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC) load("glBufferStorage");
+    // GPU-driven culling wants all three, BlockBatch checks every pointer
+    if (hasGLFeature(4, 3, "GL_ARB_compute_shader") &&
+        hasGLFeature(4, 3, "GL_ARB_shader_storage_buffer_object")) {
+        glad_glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC) load("glDispatchCompute");
+        glad_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC) load("glMemoryBarrier");
+    }
+    if (hasGLFeature(4, 3, "GL_ARB_multi_draw_indirect"))
+        glad_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC) load("glMultiDrawElementsIndirect");
+}
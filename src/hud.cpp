@@ -0,0 +1,91 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include "hud.h"
+
+Hud::Hud(FreeType *font) : font(font) {
+    glGenVertexArrays(1, &VAO);
+}
+
+int Hud::addLabel(GLfloat scale, glm::vec3 color, const std::string &text) {
+    Label label;
+    label.text = text;
+    label.scale = scale;
+    label.color = color;
+    labels.push_back(label);
+    changed = true;
+    return (int) labels.size() - 1;
+}
+
+void Hud::setText(int index, const std::string &text) {
+    Label &label = labels[index];
+    label.numbered = false;
+    if (label.text == text) return;
+    label.text = text;
+    label.dirty = true;
+    changed = true;
+}
+
+void Hud::setNumber(int index, const std::string &prefix, int value, const std::string &suffix) {
+    Label &label = labels[index];
+    if (label.numbered && label.number == value) return;
+    setText(index, prefix + std::to_string(value) + suffix);
+    label.numbered = true;
+    label.number = value;
+}
+
+void Hud::setPosition(int index, GLfloat x, GLfloat y) {
+    Label &label = labels[index];
+    if (label.x == x && label.y == y) return;
+    label.x = x;
+    label.y = y;
+    label.dirty = true;
+    changed = true;
+}
+
+void Hud::setVisible(int index, bool visible) {
+    Label &label = labels[index];
+    if (label.visible == visible) return;
+    label.visible = visible;
+    changed = true;
+}
+
+void Hud::draw() {
+    relayouts = 0;
+    if (font->generation() != fontGeneration) {
+        // glyphs may have moved to other atlas pages
+        for (Label &label : labels) label.dirty = true;
+        changed = true;
+    }
+    if (changed) {
+        relayout();
+        // a glyph rasterised for one label evicted a page another label was laid out on
+        if (font->generation() != fontGeneration) {
+            for (Label &label : labels) label.dirty = true;
+            relayout();
+        }
+    }
+    // keep the pages on screen the most recently used ones
+    font->touchPages(visiblePages);
+    font->drawVertices(VAO, streamGeneration, vertices);
+}
+
+void Hud::relayout() {
+    fontGeneration = font->generation();
+    vertices.clear();
+    visiblePages = 0;
+    for (Label &label : labels) {
+        if (label.dirty) {
+            label.vertices.clear();
+            label.pages = font->layoutText(label.text, label.x, label.y, label.scale, label.color, label.vertices);
+            label.dirty = false;
+            ++relayouts;
+        }
+        if (label.visible) {
+            vertices.insert(vertices.end(), label.vertices.begin(), label.vertices.end());
+            visiblePages |= label.pages;
+        }
+    }
+    changed = false;
+}
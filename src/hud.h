@@ -0,0 +1,66 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "text.h"
+
+// Retained HUD: every label keeps its laid out quads and only re-lays them out
+// when its text, position or style changed. The combined vertex buffer is only
+// rebuilt when some label changed or was shown/hidden, so a steady HUD costs one
+// copy into the stream buffer and one draw call. An atlas page eviction lays every
+// label out again.
+class Hud {
+public:
+    explicit Hud(FreeType *font);
+
+    // returns the handle used by the setters below
+    int addLabel(GLfloat scale, glm::vec3 color, const std::string &text = "");
+
+    void setText(int label, const std::string &text);
+
+    // formats "<prefix><value><suffix>" only when value differs from the last call
+    void setNumber(int label, const std::string &prefix, int value, const std::string &suffix = "");
+
+    void setPosition(int label, GLfloat x, GLfloat y);
+
+    void setVisible(int label, bool visible);
+
+    void draw();
+
+    // labels re-laid out by the last draw(), 0 in steady state
+    unsigned lastRelayouts() const { return relayouts; }
+
+private:
+    struct Label {
+        std::string text;
+        GLfloat x = 0.0f, y = 0.0f, scale;
+        glm::vec3 color;
+        bool visible = true;
+        bool dirty = true;
+        bool numbered = false;
+        int number = 0;
+        std::vector<GlyphVertex> vertices;
+        uint32_t pages = 0;     // atlas pages the vertices sample
+    };
+
+    FreeType *font;
+    std::vector<Label> labels;
+    bool changed = true;    // the combined buffer is out of date
+    unsigned relayouts = 0;
+    unsigned fontGeneration = 0;    // atlas evictions the cached quads were laid out against
+    uint32_t visiblePages = 0;
+
+    void relayout();
+
+    GLuint VAO{};
+    unsigned streamGeneration = ~0u;    // stream buffer the VAO points at
+    std::vector<GlyphVertex> vertices;  // every visible label
+};
@@ -0,0 +1,221 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "lightmap.h"
+
+// hemisphere rays per texel and how far away a block still occludes
+static const int AO_RAYS = 16;
+static const float AO_DISTANCE = 3.0f;
+// ray origins sit this far off the face so they start in air
+static const float SURFACE_OFFSET = 0.01f;
+
+static bool inside(glm::ivec3 g, glm::ivec3 size) {
+    return g.x >= 0 && g.y >= 0 && g.z >= 0 && g.x < size.x && g.y < size.y && g.z < size.z;
+}
+
+VoxelGrid::VoxelGrid(glm::ivec3 origin, glm::ivec3 size) : origin(origin), size(size) {
+    cells.assign((size_t) size.x * size.y * size.z, 0);
+}
+
+void VoxelGrid::set(glm::ivec3 cell) {
+    glm::ivec3 g = cell - origin;
+    if (!inside(g, size))
+        return;
+    cells[((size_t) g.z * size.y + g.y) * size.x + g.x] = 1;
+}
+
+bool VoxelGrid::solid(glm::ivec3 cell) const {
+    glm::ivec3 g = cell - origin;
+    if (g.y < 0)
+        return true;
+    if (!inside(g, size))
+        return false;
+    return cells[((size_t) g.z * size.y + g.y) * size.x + g.x] != 0;
+}
+
+float VoxelGrid::trace(glm::vec3 from, glm::vec3 dir, float maxDistance) const {
+    // walk the cells the ray crosses in order (Amanatides & Woo), in cell units where cell c is [c, c + 1)
+    glm::vec3 p = (from + 1.0f) * 0.5f;
+    glm::ivec3 cell(glm::floor(p));
+    glm::ivec3 step(0);
+    glm::vec3 next(std::numeric_limits<float>::infinity()), delta(std::numeric_limits<float>::infinity());
+    for (int a = 0; a < 3; ++a) {
+        if (dir[a] > 0.0f) {
+            step[a] = 1;
+            delta[a] = 2.0f / dir[a];
+            next[a] = ((float) cell[a] + 1.0f - p[a]) * delta[a];
+        } else if (dir[a] < 0.0f) {
+            step[a] = -1;
+            delta[a] = -2.0f / dir[a];
+            next[a] = (p[a] - (float) cell[a]) * delta[a];
+        }
+    }
+    float t = 0.0f;
+    while (t < maxDistance) {
+        if (solid(cell))
+            return t;
+        int a = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+        t = next[a];
+        cell[a] += step[a];
+        next[a] += delta[a];
+    }
+    return maxDistance;
+}
+
+static glm::vec3 faceNormal(int direction) {
+    glm::vec3 normal(0.0f);
+    normal[direction / 2] = direction % 2 ? -1.0f : 1.0f;
+    return normal;
+}
+
+static unsigned hash(unsigned x) {
+    x ^= x >> 16u;
+    x *= 0x7feb352du;
+    x ^= x >> 15u;
+    x *= 0x846ca68bu;
+    x ^= x >> 16u;
+    return x;
+}
+
+Lightmap::Lightmap(const VoxelGrid &grid, const std::vector<PointLight> &staticLights, ThreadPool &pool)
+        : origin(grid.origin), size(grid.size), lightCount((int) staticLights.size()) {
+    auto start = std::chrono::steady_clock::now();
+
+    // every face of a solid cell that borders air
+    for (int z = 0; z < size.z; ++z)
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x) {
+                glm::ivec3 cell = origin + glm::ivec3(x, y, z);
+                if (!grid.solid(cell)) continue;
+                for (int direction = 0; direction < 6; ++direction)
+                    if (!grid.solid(cell + glm::ivec3(faceNormal(direction))))
+                        faces.push_back({cell, direction});
+            }
+
+    tilesPerRow = std::max(1, (int) std::ceil(std::sqrt((double) faces.size())));
+    int tileRows = std::max(1, ((int) faces.size() + tilesPerRow - 1) / tilesPerRow);
+    int width = tilesPerRow * TILE, height = tileRows * TILE;
+    std::vector<glm::vec4> texels((size_t) width * height, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    pool.parallelFor(faces.size(), 16, [&](size_t begin, size_t end) {
+        std::vector<PointLight> nearby;
+        for (size_t f = begin; f < end; ++f) {
+            const Face &face = faces[f];
+            int axis = face.direction / 2;
+            glm::vec3 normal = faceNormal(face.direction);
+            glm::vec3 u(0.0f), v(0.0f);
+            u[(axis + 1) % 3] = 1.0f;
+            v[(axis + 2) % 3] = 1.0f;
+            glm::vec3 center = glm::vec3(face.cell) * 2.0f + normal;
+
+            // the lights that reach any part of the face, its half diagonal is sqrt(2)
+            nearby.clear();
+            for (const PointLight &light : staticLights)
+                if (glm::length(light.position - center) < light.radius + 1.4143f)
+                    nearby.push_back(light);
+
+            int tileX = (int) (f % tilesPerRow) * TILE, tileY = (int) (f / tilesPerRow) * TILE;
+            for (int ty = 0; ty < TILE; ++ty)
+                for (int tx = 0; tx < TILE; ++tx) {
+                    // texel centres over the face's [-1, 1] square, objShader.fs maps back the same way
+                    float lu = ((float) tx + 0.5f) / TILE * 2.0f - 1.0f;
+                    float lv = ((float) ty + 0.5f) / TILE * 2.0f - 1.0f;
+                    glm::vec3 position = center + u * lu + v * lv;
+                    unsigned seed = hash((unsigned) (f * TILE * TILE + ty * TILE + tx));
+                    texels[(size_t) (tileY + ty) * width + tileX + tx] = bakeTexel(grid, nearby, position, normal, seed);
+                }
+        }
+    });
+
+    // (cell, face) -> tile + 1, 0 where the face is hidden
+    std::vector<uint32_t> tiles((size_t) size.x * 6 * size.y * size.z, 0);
+    for (size_t f = 0; f < faces.size(); ++f) {
+        glm::ivec3 g = faces[f].cell - origin;
+        tiles[((size_t) g.z * size.y + g.y) * size.x * 6 + g.x * 6 + faces[f].direction] = (uint32_t) f + 1;
+    }
+
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenTextures(1, &faceTiles);
+    glBindTexture(GL_TEXTURE_3D, faceTiles);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32UI, size.x * 6, size.y, size.z, 0, GL_RED_INTEGER, GL_UNSIGNED_INT,
+                 tiles.data());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    bakeTime = elapsed.count();
+}
+
+Lightmap::~Lightmap() {
+    glDeleteTextures(1, &atlas);
+    glDeleteTextures(1, &faceTiles);
+}
+
+glm::vec4 Lightmap::bakeTexel(const VoxelGrid &grid, const std::vector<PointLight> &lights, glm::vec3 position,
+                              glm::vec3 normal, unsigned seed) {
+    glm::vec3 from = position + normal * SURFACE_OFFSET;
+    glm::vec3 tangent = std::abs(normal.y) < 0.9f ? glm::normalize(glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f)))
+                                                  : glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 bitangent = glm::cross(normal, tangent);
+
+    // cosine weighted spiral over the hemisphere, turned per texel so neighbours do not band
+    float rotation = (float) (seed & 0xffffu) / 65536.0f * 6.2831853f;
+    float occlusion = 0.0f;
+    for (int i = 0; i < AO_RAYS; ++i) {
+        float r = std::sqrt(((float) i + 0.5f) / AO_RAYS);
+        float phi = (float) i * 2.3999632f + rotation;
+        glm::vec3 dir = tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) +
+                        normal * std::sqrt(1.0f - r * r);
+        occlusion += 1.0f - grid.trace(from, dir, AO_DISTANCE) / AO_DISTANCE;
+    }
+
+    // diffuse of the static lights with the falloff of objShader.fs, shadowed by the blocks
+    glm::vec3 light(0.0f);
+    for (const PointLight &point : lights) {
+        glm::vec3 toLight = point.position - position;
+        float distance = glm::length(toLight);
+        if (distance >= point.radius || distance <= 0.0f)
+            continue;
+        glm::vec3 lightDir = toLight / distance;
+        float diff = glm::dot(normal, lightDir);
+        if (diff <= 0.0f || grid.trace(from, lightDir, distance) < distance)
+            continue;
+        float window = glm::clamp(1.0f - std::pow(distance / point.radius, 4.0f), 0.0f, 1.0f);
+        light += point.color * diff * window * window / (distance * distance + 1.0f);
+    }
+    return glm::vec4(light, 1.0f - occlusion / AO_RAYS);
+}
+
+void Lightmap::setUniforms(const Shader &shader) const {
+    shader.use();
+    shader.setInt("lightmap", LIGHTMAP_UNIT);
+    shader.setInt("lightmapFaces", LIGHTMAP_FACES_UNIT);
+    glUniform3i(shader.getLocation("lightmapOrigin"), origin.x, origin.y, origin.z);
+    glUniform2i(shader.getLocation("lightmapLayout"), tilesPerRow, TILE);
+    shader.setInt("staticLights", lightCount);
+}
+
+void Lightmap::bind() const {
+    glActiveTexture(GL_TEXTURE0 + LIGHTMAP_UNIT);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glActiveTexture(GL_TEXTURE0 + LIGHTMAP_FACES_UNIT);
+    glBindTexture(GL_TEXTURE_3D, faceTiles);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,81 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader.h>
+
+#include "lights.h"
+#include "thread_pool.h"
+
+// The lightmap is sampled by objShader.fs through units 9 and 10, after the mark grid
+const int LIGHTMAP_UNIT = 9;
+const int LIGHTMAP_FACES_UNIT = 10;
+
+// Which block cells of the level are solid. Cell c spans [2c - 1, 2c + 1] on
+// every axis, the same spacing the blocks are placed at; grid index 0 is the
+// cell origin. Outside the grid everything below is solid and the rest is air.
+struct VoxelGrid {
+    glm::ivec3 origin, size;
+    std::vector<uint8_t> cells;
+
+    VoxelGrid(glm::ivec3 origin, glm::ivec3 size);
+
+    void set(glm::ivec3 cell);
+
+    bool solid(glm::ivec3 cell) const;
+
+    // distance along dir (normalized) to the first solid cell, maxDistance when there is none
+    float trace(glm::vec3 from, glm::vec3 dir, float maxDistance) const;
+};
+
+// Ambient occlusion and the light of the static point lights, baked at level
+// load for every block face that borders air. Each face gets a TILE x TILE
+// tile of an RGBA16F atlas (rgb the static light reaching it, shadowed by the
+// voxel grid, a the ambient occlusion); a 3D R32UI texture maps (cell, face)
+// to its tile. The faces are baked in parallel on the thread pool, so block
+// shading of those lights comes down to one texture fetch.
+class Lightmap {
+public:
+    static const int TILE = 8;
+
+    // staticLights have to be the first lights added to the light grid every frame
+    Lightmap(const VoxelGrid &grid, const std::vector<PointLight> &staticLights, ThreadPool &pool);
+
+    ~Lightmap();
+
+    Lightmap(const Lightmap &) = delete;
+
+    Lightmap &operator=(const Lightmap &) = delete;
+
+    // lightmap uniforms of a program that samples it
+    void setUniforms(const Shader &shader) const;
+
+    void bind() const;
+
+    size_t faceCount() const { return faces.size(); }
+
+    double bakeMilliseconds() const { return bakeTime; }
+
+private:
+    struct Face {
+        glm::ivec3 cell;
+        int direction;  // axis * 2, + 1 when facing down the axis
+    };
+
+    glm::ivec3 origin, size;
+    int lightCount;     // the first lights of the light grid are these, objShader.fs skips them
+    std::vector<Face> faces;
+    int tilesPerRow = 1;
+    double bakeTime = 0.0;
+    GLuint atlas = 0, faceTiles = 0;
+
+    static glm::vec4 bakeTexel(const VoxelGrid &grid, const std::vector<PointLight> &lights, glm::vec3 position,
+                               glm::vec3 normal, unsigned seed);
+};
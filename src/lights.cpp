@@ -0,0 +1,129 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "lights.h"
+
+static const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+
+LightGrid::LightGrid(glm::vec2 origin, float cellSize, int cellsX, int cellsZ, StreamBuffer *stream)
+        : origin(origin), cellSize(cellSize), cellsX(cellsX), cellsZ(cellsZ), stream(stream) {
+    if (glTexBufferRange)
+        glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &streamAlignment);
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+    for (int i = 0; i < 3; ++i) {
+        // never empty, a zero sized texture buffer is not guaranteed to be sampleable
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LightGrid::~LightGrid() {
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+}
+
+void LightGrid::cellRange(const PointLight &light, int &x0, int &z0, int &x1, int &z1) const {
+    x0 = std::max(0, (int) std::floor((light.position.x - light.radius - origin.x) / cellSize));
+    z0 = std::max(0, (int) std::floor((light.position.z - light.radius - origin.y) / cellSize));
+    x1 = std::min(cellsX - 1, (int) std::floor((light.position.x + light.radius - origin.x) / cellSize));
+    z1 = std::min(cellsZ - 1, (int) std::floor((light.position.z + light.radius - origin.y) / cellSize));
+}
+
+void LightGrid::build() {
+    // the bins only depend on where the lights are and how far they reach; flicker and glow only
+    // change colours, so most frames upload the light data alone
+    bool moved = !binnedValid || binned.size() != lights.size();
+    for (size_t i = 0; !moved && i < lights.size(); ++i)
+        moved = binned[i] != glm::vec4(lights[i].position, lights[i].radius);
+    if (moved) bin();
+
+    lightData.clear();
+    for (const PointLight &light : lights) {
+        lightData.emplace_back(light.position, light.radius);
+        lightData.emplace_back(light.color, 0.0f);
+    }
+    if (lightData.empty()) lightData.emplace_back(0.0f);
+    auto size = (GLsizeiptr) (lightData.size() * sizeof(glm::vec4));
+    if (glTexBufferRange) {
+        GLintptr offset = stream->write(lightData.data(), size, streamAlignment);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[0]);
+        glTexBufferRange(GL_TEXTURE_BUFFER, formats[0], stream->buffer(), offset, size);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        return;
+    }
+    // re-specifying the whole store hands the driver a fresh one instead of waiting for the last frame
+    glBindBuffer(GL_TEXTURE_BUFFER, buffers[0]);
+    glBufferData(GL_TEXTURE_BUFFER, size, lightData.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightGrid::bin() {
+    binned.clear();
+    for (const PointLight &light : lights)
+        binned.emplace_back(light.position, light.radius);
+    binnedValid = true;
+
+    // counting sort: count the lights per cell, prefix sum into offsets, then scatter
+    cells.assign(cellsX * cellsZ * 2, 0);
+    for (const PointLight &light : lights) {
+        int x0, z0, x1, z1;
+        cellRange(light, x0, z0, x1, z1);
+        for (int z = z0; z <= z1; ++z)
+            for (int x = x0; x <= x1; ++x)
+                ++cells[(z * cellsX + x) * 2 + 1];
+    }
+    uint32_t offset = 0;
+    maxPerCell = 0;
+    for (int c = 0; c < cellsX * cellsZ; ++c) {
+        cells[c * 2] = offset;
+        offset += cells[c * 2 + 1];
+        maxPerCell = std::max(maxPerCell, cells[c * 2 + 1]);
+        cells[c * 2 + 1] = 0;
+    }
+    indices.resize(std::max<uint32_t>(offset, 1));
+    for (uint32_t i = 0; i < lights.size(); ++i) {
+        int x0, z0, x1, z1;
+        cellRange(lights[i], x0, z0, x1, z1);
+        for (int z = z0; z <= z1; ++z)
+            for (int x = x0; x <= x1; ++x) {
+                uint32_t *cell = &cells[(z * cellsX + x) * 2];
+                indices[cell[0] + cell[1]++] = i;
+            }
+    }
+
+    // the bins stay in buffers of their own until a light moves again
+    const void *data[2] = {cells.data(), indices.data()};
+    size_t sizes[2] = {cells.size() * sizeof(uint32_t), indices.size() * sizeof(uint32_t)};
+    for (int i = 1; i < 3; ++i) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr) sizes[i - 1], data[i - 1], GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightGrid::setUniforms(const Shader &shader) const {
+    shader.use();
+    shader.setInt("lightData", LIGHT_DATA_UNIT);
+    shader.setInt("lightCells", LIGHT_CELLS_UNIT);
+    shader.setInt("lightIndices", LIGHT_INDICES_UNIT);
+    glUniform4f(shader.getLocation("lightGrid"), origin.x, origin.y, 1.0f / cellSize, 0.0f);
+    glUniform2i(shader.getLocation("lightGridSize"), cellsX, cellsZ);
+}
+
+void LightGrid::bind() const {
+    const int units[3] = {LIGHT_DATA_UNIT, LIGHT_CELLS_UNIT, LIGHT_INDICES_UNIT};
+    for (int i = 0; i < 3; ++i) {
+        glActiveTexture(GL_TEXTURE0 + units[i]);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,83 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader.h>
+
+#include "stream_buffer.h"
+
+// The light grid is read through three texture buffers on units 5-7, after the block textures
+const int LIGHT_DATA_UNIT = 5;
+const int LIGHT_CELLS_UNIT = 6;
+const int LIGHT_INDICES_UNIT = 7;
+
+struct PointLight {
+    glm::vec3 position;
+    float radius;       // no contribution past this distance
+    glm::vec3 color;    // already scaled by intensity
+};
+
+// Bins point lights into the cells of a regular grid on the xz plane, the
+// maze's own cells, so a fragment only shades the lights whose radius reaches
+// its cell. objShader.fs reads it through texture buffers: light data, per
+// cell (offset, count), and the index list. The light data is uploaded every
+// frame, as a range of the stream buffer with GL 4.3 / ARB_texture_buffer_range
+// and into a re-specified buffer of its own otherwise. The cells and indices
+// are only binned again when a light moves, appears or disappears, and stay
+// in buffers of their own in between.
+class LightGrid {
+public:
+    // cells of cellSize starting at origin (the corner, not the centre of the first cell)
+    LightGrid(glm::vec2 origin, float cellSize, int cellsX, int cellsZ, StreamBuffer *stream);
+
+    ~LightGrid();
+
+    LightGrid(const LightGrid &) = delete;
+
+    LightGrid &operator=(const LightGrid &) = delete;
+
+    void clear() { lights.clear(); }
+
+    void add(const PointLight &light) { lights.push_back(light); }
+
+    // upload the lights added since clear(), binning them again if they are not where they were
+    void build();
+
+    // grid uniforms of a program that samples the light grid
+    void setUniforms(const Shader &shader) const;
+
+    void bind() const;
+
+    size_t lightCount() const { return lights.size(); }
+
+    unsigned maxLightsPerCell() const { return maxPerCell; }
+
+private:
+    glm::vec2 origin;
+    float cellSize;
+    int cellsX, cellsZ;
+
+    std::vector<PointLight> lights;
+    std::vector<glm::vec4> lightData;       // (position, radius), (color, 0) per light
+    std::vector<uint32_t> cells;            // (offset, count) per cell
+    std::vector<uint32_t> indices;
+    unsigned maxPerCell = 0;
+    std::vector<glm::vec4> binned;          // (position, radius) of the lights the bins were made for
+    bool binnedValid = false;
+
+    StreamBuffer *stream;
+    GLint streamAlignment = 16;
+    GLuint buffers[3]{};    // own stores for the fallback, also what the textures start out with
+    GLuint textures[3]{};
+
+    void cellRange(const PointLight &light, int &x0, int &z0, int &x1, int &z1) const;
+
+    void bin();
+};
@@ -0,0 +1,47 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include "marks.h"
+
+MarkGrid::MarkGrid(int rows, int layers, int cols) : rows(rows), layers(layers), cols(cols) {
+    bits.assign((index(0, 0, cols) + 31) / 32, 0);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    // texel (row, layer, col), the same order as a block's position over 2
+    std::vector<uint8_t> zeros((size_t) rows * layers * cols, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8UI, rows, layers, cols, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, zeros.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+MarkGrid::~MarkGrid() {
+    glDeleteTextures(1, &texture);
+}
+
+bool MarkGrid::marked(int row, int layer, int col) const {
+    size_t i = index(row, layer, col);
+    return (bits[i / 32] >> (i % 32)) & 1u;
+}
+
+bool MarkGrid::toggle(int row, int layer, int col) {
+    size_t i = index(row, layer, col);
+    bits[i / 32] ^= 1u << (i % 32);
+    uint8_t value = marked(row, layer, col);
+    marks = value ? marks + 1 : marks - 1;
+
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, row, layer, col, 1, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &value);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return value;
+}
+
+void MarkGrid::bind() const {
+    glActiveTexture(GL_TEXTURE0 + MARK_UNIT);
+    glBindTexture(GL_TEXTURE_3D, texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,45 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+// The mark bitmap is sampled by objShader.vs through unit 8, after the light grid
+const int MARK_UNIT = 8;
+
+// One bit per wall block over (row, layer, col), mirrored to a GL_R8UI 3D
+// texture of the same shape that the instanced block shader reads to draw
+// marked blocks with the mark layer. Any number of marks costs no extra draw,
+// and toggling one rewrites a single texel.
+class MarkGrid {
+public:
+    MarkGrid(int rows, int layers, int cols);
+
+    ~MarkGrid();
+
+    MarkGrid(const MarkGrid &) = delete;
+
+    MarkGrid &operator=(const MarkGrid &) = delete;
+
+    bool marked(int row, int layer, int col) const;
+
+    // flip a block's mark, returns whether it is marked now
+    bool toggle(int row, int layer, int col);
+
+    unsigned count() const { return marks; }
+
+    void bind() const;
+
+private:
+    int rows, layers, cols;
+    std::vector<uint32_t> bits;
+    unsigned marks = 0;
+    GLuint texture = 0;
+
+    size_t index(int row, int layer, int col) const { return ((size_t) col * layers + layer) * rows + row; }
+};
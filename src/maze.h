@@ -57,17 +57,17 @@ public:
 
     bool isWall(int i, int j) const;
 
-    bool Maze::isStartPoint(int, int);
-    glm::vec3 Maze::getStartPoint();
+    bool isStartPoint(int, int);
+    glm::vec3 getStartPoint();
 
-    bool Maze::isEndPoint(int, int);
-    glm::vec3 Maze::getEndPoint();
+    bool isEndPoint(int, int);
+    glm::vec3 getEndPoint();
 
-    Thing Maze::getThingOne();
+    Thing getThingOne();
 
-    Thing Maze::getThingTwo();
+    Thing getThingTwo();
 
-    Thing Maze::getThingThree();
+    Thing getThingThree();
 
 };
 
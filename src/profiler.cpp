@@ -0,0 +1,51 @@
+//
+// Created by light on 10/18/2026.
+//
+
+#include "profiler.h"
+
+GpuTimer::GpuTimer() {
+    glGenQueries(QUERY_COUNT, queries);
+}
+
+GpuTimer::~GpuTimer() {
+    glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void GpuTimer::begin() {
+    collect();
+    // the oldest query is still in flight, skip this sample rather than stall
+    if (pending[current]) return;
+    glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+}
+
+void GpuTimer::end() {
+    if (pending[current]) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    pending[current] = true;
+    current = (current + 1) % QUERY_COUNT;
+}
+
+void GpuTimer::collect() {
+    for (int i = 0; i < QUERY_COUNT; ++i) {
+        if (!pending[i]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        double ms;
+        if (glGetQueryObjectui64v) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+            ms = ns / 1.0e6;
+        } else {
+            GLuint ns = 0;
+            glGetQueryObjectuiv(queries[i], GL_QUERY_RESULT, &ns);
+            ms = ns / 1.0e6;
+        }
+        pending[i] = false;
+
+        average = samples == 0 ? ms : average * 0.95 + ms * 0.05;
+        ++samples;
+    }
+}
@@ -0,0 +1,41 @@
+//
+// Created by light on 10/18/2026.
+//
+
+#pragma once
+
+#include "glext.h"
+
+// Measures the GPU time spent between begin() and end() with GL_TIME_ELAPSED
+// queries. Results are read back a few frames late so the CPU never waits on
+// the GPU, and are smoothed into a moving average in milliseconds.
+class GpuTimer {
+public:
+    GpuTimer();
+
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer &) = delete;
+
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    void begin();
+
+    void end();
+
+    double milliseconds() const { return average; }
+
+    bool valid() const { return samples > 0; }
+
+private:
+    static const int QUERY_COUNT = 4;
+
+    GLuint queries[QUERY_COUNT]{};
+    bool pending[QUERY_COUNT]{};
+    int current = 0;
+
+    double average = 0.0;
+    long samples = 0;
+
+    void collect();
+};
@@ -0,0 +1,105 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "program_cache.h"
+
+namespace {
+    const uint32_t MAGIC = 0x48494d50;  // "HIMP"
+
+    struct BinaryHeader {
+        uint32_t magic;
+        uint32_t format;
+        uint32_t length;
+        float compileMilliseconds;
+    };
+
+    // FNV-1a, stable across runs and platforms unlike std::hash
+    uint64_t hash(const std::string &text, uint64_t seed = 0xcbf29ce484222325ull) {
+        uint64_t h = seed;
+        for (unsigned char c : text) {
+            h ^= c;
+            h *= 0x100000001b3ull;
+        }
+        return h;
+    }
+}
+
+ProgramCache::ProgramCache(const std::string &directory) : directory(directory) {
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        auto value = (const char *) glGetString(name);
+        driver += value ? value : "";
+        driver += '\n';
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+}
+
+bool ProgramCache::supported() {
+    if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri) return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+std::string ProgramCache::path(const std::string &sources) const {
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long) hash(sources, hash(driver)));
+    return directory + "/" + name + ".bin";
+}
+
+GLuint ProgramCache::load(const std::string &sources) {
+    auto start = std::chrono::steady_clock::now();
+    std::ifstream file(path(sources), std::ios::binary);
+    BinaryHeader header{};
+    if (!file || !file.read((char *) &header, sizeof(header)) || header.magic != MAGIC) {
+        ++missCount;
+        return 0;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), header.length)) {
+        ++missCount;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), (GLsizei) header.length);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // the driver changed its mind about the format, compile and overwrite
+        glDeleteProgram(program);
+        ++missCount;
+        return 0;
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    saved += header.compileMilliseconds - elapsed.count();
+    ++hitCount;
+    return program;
+}
+
+void ProgramCache::prepare(GLuint program) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::save(const std::string &sources, GLuint program, double milliseconds) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> binary(length);
+    BinaryHeader header{MAGIC, 0, 0, (float) milliseconds};
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &header.format, binary.data());
+    if (written <= 0) return;
+    header.length = (uint32_t) written;
+
+    std::ofstream file(path(sources), std::ios::binary | std::ios::trunc);
+    file.write((const char *) &header, sizeof(header));
+    file.write(binary.data(), written);
+}
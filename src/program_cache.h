@@ -0,0 +1,45 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <learnopengl/shader.h>
+
+#include "glext.h"
+
+// On-disk cache of linked program binaries, one file per program named after
+// a hash of its sources and the GL vendor, renderer and version, so a driver
+// update simply misses. A binary the driver refuses is recompiled and written
+// again. Every file remembers what compiling it cost, which is what a hit saves.
+class ProgramCache : public ProgramStore {
+public:
+    explicit ProgramCache(const std::string &directory);
+
+    // GL 4.1 / ARB_get_program_binary with at least one binary format
+    static bool supported();
+
+    GLuint load(const std::string &sources) override;
+
+    void prepare(GLuint program) override;
+
+    void save(const std::string &sources, GLuint program, double milliseconds) override;
+
+    unsigned hits() const { return hitCount; }
+
+    unsigned misses() const { return missCount; }
+
+    // compile time of the cached programs minus the time it took to load them
+    double savedMilliseconds() const { return saved; }
+
+private:
+    std::string directory;
+    std::string driver;     // vendor, renderer and version, part of every key
+    unsigned hitCount = 0, missCount = 0;
+    double saved = 0.0;
+
+    std::string path(const std::string &sources) const;
+};
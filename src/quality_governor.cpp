@@ -0,0 +1,52 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include <algorithm>
+
+#include "quality_governor.h"
+
+const QualityLevel QualityGovernor::LEVELS[] = {
+        {1.0f,  1024, 1},
+        {1.0f,  512,  1},
+        {0.85f, 512,  2},
+        {0.75f, 512,  2},
+        {0.67f, 256,  3},
+        {0.5f,  256,  4},
+};
+const int QualityGovernor::LEVEL_COUNT = sizeof(LEVELS) / sizeof(LEVELS[0]);
+
+bool QualityGovernor::update(double cpuMs, double gpuMs) {
+    // whichever side is the bottleneck sets the frame rate
+    double frame = std::max(cpuMs, gpuMs);
+    smoothed = smoothed == 0.0 ? frame : smoothed * 0.9 + frame * 0.1;
+
+    if (settle > 0) {
+        --settle;
+        return false;
+    }
+
+    over = smoothed > budget * DOWN_RATIO ? over + 1 : 0;
+    under = smoothed < budget * UP_RATIO ? under + 1 : 0;
+    if (over >= DOWN_FRAMES && current + 1 < LEVEL_COUNT) {
+        change(current + 1);
+        return true;
+    }
+    if (under >= UP_FRAMES && current > 0) {
+        change(current - 1);
+        return true;
+    }
+    return false;
+}
+
+void QualityGovernor::reset() {
+    change(0);
+    smoothed = 0.0;
+}
+
+void QualityGovernor::change(int level) {
+    current = level;
+    over = 0;
+    under = 0;
+    settle = SETTLE_FRAMES;
+}
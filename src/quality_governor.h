@@ -0,0 +1,58 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <glad/glad.h>
+
+// One rung of the quality ladder, from full quality down
+struct QualityLevel {
+    float renderScale;      // of the window size, the scene is upscaled to the window
+    GLuint shadowSize;      // side of a shadow map face
+    int shadowInterval;     // shadow maps are redrawn every this many frames
+};
+
+// Holds the frame time under a budget by walking the quality ladder. The
+// slower of the CPU and GPU frame time is smoothed; a level is dropped once
+// it stays over budget for a few frames and raised only after a long stretch
+// well under budget, and every change is followed by a settling period while
+// the timers catch up, so the governor does not oscillate between two levels.
+class QualityGovernor {
+public:
+    explicit QualityGovernor(double budgetMs) : budget(budgetMs) {}
+
+    // timings of one frame in milliseconds, returns true when the level changed
+    bool update(double cpuMs, double gpuMs);
+
+    // back to full quality
+    void reset();
+
+    const QualityLevel &level() const { return LEVELS[current]; }
+
+    // the top of the ladder, what the levels below scale down from
+    static const QualityLevel &full() { return LEVELS[0]; }
+
+    int levelIndex() const { return current; }
+
+    double frameMs() const { return smoothed; }
+
+    double budgetMs() const { return budget; }
+
+private:
+    static const QualityLevel LEVELS[];
+    static const int LEVEL_COUNT;
+
+    static constexpr double DOWN_RATIO = 1.05;  // over budget above this
+    static constexpr double UP_RATIO = 0.7;     // room for a better level below this
+    static const int DOWN_FRAMES = 20;
+    static const int UP_FRAMES = 180;
+    static const int SETTLE_FRAMES = 45;
+
+    double budget;
+    double smoothed = 0.0;
+    int current = 0;
+    int over = 0, under = 0, settle = 0;
+
+    void change(int level);
+};
@@ -0,0 +1,107 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include <set>
+
+#include "render_graph.h"
+
+const char *const RenderGraph::BACKBUFFER = "backbuffer";
+
+std::vector<bool> RenderGraph::cull() const {
+    // walk back from the window: a pass lives if a live pass (or the window) needs something it writes
+    std::vector<bool> alive(passes.size(), false);
+    std::set<std::string> needed = {BACKBUFFER};
+    for (size_t i = passes.size(); i-- > 0;) {
+        for (const std::string &resource : passes[i].writes) {
+            if (needed.count(resource)) {
+                alive[i] = true;
+                break;
+            }
+        }
+        if (alive[i]) needed.insert(passes[i].reads.begin(), passes[i].reads.end());
+    }
+    return alive;
+}
+
+void RenderGraph::bind(const GraphPass &pass) {
+    if (!known || framebuffer != pass.framebuffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+        framebuffer = pass.framebuffer;
+    }
+    if (!known || width != pass.width || height != pass.height) {
+        glViewport(0, 0, pass.width, pass.height);
+        width = pass.width;
+        height = pass.height;
+    }
+}
+
+void RenderGraph::clearTarget(const GraphPass &pass) {
+    if (!pass.clear) return;
+    // clears honour the write masks
+    if ((pass.clear & GL_DEPTH_BUFFER_BIT) && !current.depthWrite) {
+        glDepthMask(GL_TRUE);
+        current.depthWrite = true;
+    }
+    if ((pass.clear & GL_COLOR_BUFFER_BIT) && !current.colorWrite) {
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        current.colorWrite = true;
+    }
+    glClear(pass.clear);
+}
+
+void RenderGraph::set(bool &state, bool wanted, GLenum capability) {
+    if (known && state == wanted) {
+        ++stats.stateSkipped;
+        return;
+    }
+    if (wanted) glEnable(capability);
+    else glDisable(capability);
+    state = wanted;
+    ++stats.stateChanges;
+}
+
+void RenderGraph::apply(const PassState &state) {
+    set(current.depthTest, state.depthTest, GL_DEPTH_TEST);
+    set(current.cullFace, state.cullFace, GL_CULL_FACE);
+    set(current.blend, state.blend, GL_BLEND);
+    if (!known || current.depthWrite != state.depthWrite) {
+        glDepthMask(state.depthWrite ? GL_TRUE : GL_FALSE);
+        current.depthWrite = state.depthWrite;
+        ++stats.stateChanges;
+    } else ++stats.stateSkipped;
+    if (!known || current.colorWrite != state.colorWrite) {
+        GLboolean mask = state.colorWrite ? GL_TRUE : GL_FALSE;
+        glColorMask(mask, mask, mask, mask);
+        current.colorWrite = state.colorWrite;
+        ++stats.stateChanges;
+    } else ++stats.stateSkipped;
+    if (!known || current.depthFunc != state.depthFunc) {
+        glDepthFunc(state.depthFunc);
+        current.depthFunc = state.depthFunc;
+        ++stats.stateChanges;
+    } else ++stats.stateSkipped;
+}
+
+void RenderGraph::execute() {
+    std::vector<bool> alive = cull();
+    for (size_t i = 0; i < passes.size(); ++i) {
+        if (!alive[i]) {
+            ++stats.culled;
+            continue;
+        }
+        const GraphPass &pass = passes[i];
+        bind(pass);
+        // masks first so the clear is not hidden by the previous pass's state
+        if (!known) apply(pass.state);
+        known = true;
+        clearTarget(pass);
+        apply(pass.state);
+        if (pass.execute) pass.execute();
+        ++stats.passes;
+    }
+    passes.clear();
+
+    frameStats = stats;
+    stats = Stats();
+}
@@ -0,0 +1,78 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Fixed function state a pass runs with
+struct PassState {
+    bool depthTest = true;
+    bool depthWrite = true;
+    GLenum depthFunc = GL_LESS;
+    bool colorWrite = true;
+    bool cullFace = true;
+    bool blend = false;
+};
+
+// One pass of a frame: the target it draws to, what it clears first, the state
+// it needs and the named resources it reads and writes.
+struct GraphPass {
+    std::string name;
+    GLuint framebuffer = 0;
+    GLsizei width = 0, height = 0;
+    GLbitfield clear = 0;
+    PassState state;
+    std::vector<std::string> reads, writes;
+    std::function<void()> execute;
+};
+
+// The passes of one frame, declared in execution order. execute() drops the
+// passes nothing on screen depends on, binds each target and only changes the
+// fixed function state that differs from the previous pass. Passes are
+// declared again every frame: a disabled feature is a pass not added, or one
+// whose output no pass reads any more.
+class RenderGraph {
+public:
+    // the window, the resource every frame ends up in
+    static const char *const BACKBUFFER;
+
+    struct Stats {
+        unsigned passes = 0, culled = 0;
+        unsigned stateChanges = 0, stateSkipped = 0;
+    };
+
+    void addPass(GraphPass pass) { passes.push_back(std::move(pass)); }
+
+    // run and forget the passes added since the last call
+    void execute();
+
+    // GL state is unknown again, call after changing it outside the graph
+    void invalidate() { known = false; }
+
+    const Stats &lastFrame() const { return frameStats; }
+
+private:
+    std::vector<GraphPass> passes;
+    Stats stats, frameStats;
+
+    bool known = false;
+    PassState current;
+    GLuint framebuffer = 0;
+    GLsizei width = 0, height = 0;
+
+    std::vector<bool> cull() const;
+
+    void bind(const GraphPass &pass);
+
+    void clearTarget(const GraphPass &pass);
+
+    void apply(const PassState &state);
+
+    void set(bool &current, bool wanted, GLenum capability);
+};
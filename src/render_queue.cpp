@@ -0,0 +1,244 @@
+//
+// Created by light on 10/18/2026.
+//
+
+#include <algorithm>
+#include <cstddef>
+
+#include "render_queue.h"
+
+void GLStateCache::useProgram(GLuint id) {
+    if (program == id) {
+        ++stats.programsSkipped;
+        return;
+    }
+    glUseProgram(id);
+    program = id;
+    ++stats.programChanges;
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+    if (unit < TEXTURE_UNITS && textures[unit] == texture && targets[unit] == target) {
+        ++stats.texturesSkipped;
+        return;
+    }
+    if (activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    glBindTexture(target, texture);
+    if (unit < TEXTURE_UNITS) {
+        textures[unit] = texture;
+        targets[unit] = target;
+    }
+    ++stats.textureChanges;
+}
+
+void GLStateCache::bindVertexArray(GLuint id) {
+    if (vao == id) {
+        ++stats.vertexArraysSkipped;
+        return;
+    }
+    glBindVertexArray(id);
+    vao = id;
+    ++stats.vertexArrayChanges;
+}
+
+void GLStateCache::invalidate() {
+    program = UNKNOWN;
+    vao = UNKNOWN;
+    activeUnit = UNKNOWN;
+    for (GLuint i = 0; i < TEXTURE_UNITS; ++i) {
+        textures[i] = UNKNOWN;
+        targets[i] = 0;
+    }
+}
+
+uint64_t RenderQueue::sortKey(RenderPass pass, GLuint program, GLuint material, GLuint mesh) {
+    // | pass: 8 | program: 8 | material: 24 | mesh: 24 |
+    return ((uint64_t) pass << 56u) |
+           ((uint64_t) (program & 0xFFu) << 48u) |
+           ((uint64_t) (material & 0xFFFFFFu) << 24u) |
+           (uint64_t) (mesh & 0xFFFFFFu);
+}
+
+void RenderQueue::submit(RenderPass pass, Shader *shader, Model *model, const glm::mat4 &transform,
+                         const glm::mat3 &normalMatrix, unsigned int lod) {
+    // depth-only passes never sample the material
+    bool textured = pass == PASS_OPAQUE;
+    for (const Mesh &mesh : model->meshes) {
+        GLuint material = textured && !mesh.textures.empty() ? mesh.textures[0].id : 0;
+        order.emplace_back(sortKey(pass, shader->ID, material, mesh.VAO), (uint32_t) items.size());
+        items.push_back(DrawItem{shader, &mesh, lod, textured, transform, normalMatrix});
+    }
+}
+
+// the sampler names a mesh sets follow from its texture types in order (texture_diffuse1, texture_specular1...)
+static bool sameSamplerLayout(const Mesh &a, const Mesh &b) {
+    if (a.textures.size() != b.textures.size()) return false;
+    for (size_t i = 0; i < a.textures.size(); ++i) {
+        if (a.textures[i].type != b.textures[i].type) return false;
+    }
+    return true;
+}
+
+static bool sameTextures(const Mesh &a, const Mesh &b) {
+    if (a.textures.size() != b.textures.size()) return false;
+    for (size_t i = 0; i < a.textures.size(); ++i) {
+        if (a.textures[i].id != b.textures[i].id) return false;
+    }
+    return true;
+}
+
+void RenderQueue::flush(bool multiDraw) {
+    if (items.empty()) return;
+    std::sort(order.begin(), order.end(),
+              [](const std::pair<uint64_t, uint32_t> &a, const std::pair<uint64_t, uint32_t> &b) {
+                  return a.first < b.first;
+              });
+
+    // one upload for the transforms of every draw, and the commands that draw them with multi-draw;
+    // a single write, so both land in the same buffer even when it makes the ring grow
+    size_t stride = (sizeof(ObjectUniforms) + stream->uniformAlignment() - 1) / stream->uniformAlignment() *
+                    stream->uniformAlignment();
+    size_t commandOffset = order.size() * stride;
+    objects.resize(commandOffset + (multiDraw ? order.size() * sizeof(DrawElementsIndirectCommand) : 0));
+    for (size_t i = 0; i < order.size(); ++i) {
+        const DrawItem &item = items[order[i].second];
+        auto *object = (ObjectUniforms *) &objects[i * stride];
+        object->model = item.model;
+        object->model_res = glm::mat4(item.model_res);
+        if (multiDraw) {
+            // one instance, its base instance is the index of its transform
+            const MeshLod &level = item.mesh->lod(item.lod);
+            auto *command = (DrawElementsIndirectCommand *) &objects[commandOffset] + i;
+            *command = DrawElementsIndirectCommand{level.count, 1, item.mesh->range.firstIndex + level.first,
+                                                   item.mesh->range.baseVertex, (GLuint) i};
+        }
+    }
+    GLintptr base = stream->write(objects.data(), (GLsizeiptr) objects.size(), stream->uniformAlignment());
+
+    // other code draws between flushes without going through the cache
+    state.invalidate();
+
+    if (multiDraw)
+        drawRuns(base, stride, base + (GLintptr) commandOffset);
+    else
+        drawEach(base, stride);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+
+    items.clear();
+    order.clear();
+}
+
+void RenderQueue::bindMaterial(const DrawItem &item, const Mesh *&current) {
+    // sampler units are program state, only refresh them when the texture layout differs
+    if (current == nullptr || !sameSamplerLayout(*current, *item.mesh)) {
+        item.mesh->setSamplerUniforms(*item.shader);
+    }
+    current = item.mesh;
+    for (unsigned int i = 0; i < item.mesh->textures.size(); ++i) {
+        state.bindTexture(i, GL_TEXTURE_2D, item.mesh->textures[i].id);
+    }
+}
+
+void RenderQueue::drawEach(GLintptr base, size_t stride) {
+    GLuint currentProgram = 0;
+    const Mesh *currentMaterial = nullptr;
+    for (size_t i = 0; i < order.size(); ++i) {
+        const DrawItem &item = items[order[i].second];
+        state.useProgram(item.shader->ID);
+        if (currentProgram != item.shader->ID) {
+            currentProgram = item.shader->ID;
+            currentMaterial = nullptr;
+        }
+        glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, stream->buffer(), base + i * stride,
+                          sizeof(ObjectUniforms));
+
+        if (item.textured) bindMaterial(item, currentMaterial);
+
+        state.bindVertexArray(item.mesh->VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, item.mesh->lod(item.lod).count, item.mesh->indexType,
+                                 (void *) item.mesh->lodOffset(item.lod), item.mesh->range.baseVertex);
+        ++draws;
+        ++calls;
+    }
+}
+
+void RenderQueue::drawRuns(GLintptr base, size_t stride, GLintptr commands) {
+    // the transforms moved with this flush's upload, point every arena's attributes at them first
+    std::vector<MeshArena *> arenas;
+    for (const std::pair<uint64_t, uint32_t> &entry : order) {
+        MeshArena *arena = items[entry.second].mesh->arena;
+        if (std::find(arenas.begin(), arenas.end(), arena) == arenas.end()) {
+            pointTransforms(arena, base, stride);
+            arenas.push_back(arena);
+        }
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream->buffer());
+    GLuint currentProgram = 0;
+    const Mesh *currentMaterial = nullptr;
+    for (size_t first = 0, last; first < order.size(); first = last) {
+        const DrawItem &item = items[order[first].second];
+        // the draws that can share a call: same program and arena, and the same textures when sampled
+        for (last = first + 1; last < order.size(); ++last) {
+            const DrawItem &next = items[order[last].second];
+            if (next.shader->ID != item.shader->ID || next.mesh->arena != item.mesh->arena ||
+                next.textured != item.textured || (item.textured && !sameTextures(*next.mesh, *item.mesh)))
+                break;
+        }
+
+        state.useProgram(item.shader->ID);
+        if (currentProgram != item.shader->ID) {
+            currentProgram = item.shader->ID;
+            currentMaterial = nullptr;
+        }
+        if (item.textured) bindMaterial(item, currentMaterial);
+
+        state.bindVertexArray(multiDrawArrays[item.mesh->arena]);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, item.mesh->indexType,
+                                    (void *) (commands + first * sizeof(DrawElementsIndirectCommand)),
+                                    (GLsizei) (last - first), 0);
+        draws += last - first;
+        ++calls;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void RenderQueue::pointTransforms(MeshArena *arena, GLintptr base, size_t stride) {
+    // a vertex array of its own over the arena's buffers, like the block batch's, so the models'
+    // shared array never carries the transform attributes
+    GLuint &vao = multiDrawArrays[arena];
+    bool created = vao == 0;
+    if (created) vao = arena->createVertexArray();
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer());
+    for (GLuint column = 0; column < 7; ++column) {
+        GLuint location = TRANSFORM_ATTRIBUTE + column;
+        if (created) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        // four columns of model, then three of model_res, each std140 column a vec4 apart
+        if (column < 4)
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, (GLsizei) stride,
+                                  (void *) (base + offsetof(ObjectUniforms, model) + column * sizeof(glm::vec4)));
+        else
+            glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, (GLsizei) stride,
+                                  (void *) (base + offsetof(ObjectUniforms, model_res) +
+                                            (column - 4) * sizeof(glm::vec4)));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RenderQueue::endFrame() {
+    frameDraws = draws;
+    draws = 0;
+    frameCalls = calls;
+    calls = 0;
+    frameStats = state.stats;
+    state.stats = GLStateCache::Stats();
+}
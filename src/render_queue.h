@@ -0,0 +1,135 @@
+//
+// Created by light on 10/18/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+
+#include "glext.h"
+#include "stream_buffer.h"
+#include "uniforms.h"
+
+// Remembers the GL bindings last made through it and drops the calls that
+// would not change anything. Whoever touches GL behind its back has to call
+// invalidate() before relying on it again.
+class GLStateCache {
+public:
+    struct Stats {
+        unsigned programChanges = 0, programsSkipped = 0;
+        unsigned textureChanges = 0, texturesSkipped = 0;
+        unsigned vertexArrayChanges = 0, vertexArraysSkipped = 0;
+
+        // the binds a draw made on its own before the cache; it never switched programs per draw,
+        // so repeated useProgram() calls are not savings
+        unsigned skipped() const { return texturesSkipped + vertexArraysSkipped; }
+
+        unsigned changes() const { return programChanges + textureChanges + vertexArrayChanges; }
+    };
+
+    GLStateCache() { invalidate(); }
+
+    void useProgram(GLuint program);
+
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    void bindVertexArray(GLuint vao);
+
+    void invalidate();
+
+    Stats stats;
+
+private:
+    static const GLuint TEXTURE_UNITS = 16;
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    GLuint program;
+    GLuint vao;
+    GLuint activeUnit;
+    GLuint textures[TEXTURE_UNITS];
+    GLenum targets[TEXTURE_UNITS];
+};
+
+enum RenderPass : uint8_t {
+    PASS_SHADOW = 0,
+    PASS_OPAQUE = 1,
+    PASS_DEPTH = 2      // the opaque geometry again, depth only
+};
+
+// Collects the draws of one pass, sorts them by (pass, program, material, mesh)
+// and submits them through a GLStateCache so runs of identical cubes only bind
+// their program, textures and vertex array once. The transforms of a flush are
+// written to the stream buffer in one go and each draw binds its ObjectBlock range.
+//
+// With multi-draw the shaders are FEATURE_MULTI_DRAW variants instead: every
+// run of draws sharing a program, a material and an arena goes out as one
+// glMultiDrawElementsIndirect, the commands written next to the transforms,
+// and each draw's baseInstance picks its transform out of the same upload
+// through the instance attributes at TRANSFORM_ATTRIBUTE.
+class RenderQueue {
+public:
+    explicit RenderQueue(StreamBuffer *stream) : stream(stream) {}
+
+    // queue every mesh of a model with the given transform, at the given level of detail
+    void submit(RenderPass pass, Shader *shader, Model *model, const glm::mat4 &transform,
+                const glm::mat3 &normalMatrix, unsigned int lod = 0);
+
+    // sort and draw everything queued so far, then empty the queue
+    void flush(bool multiDraw = false);
+
+    // GL 4.3 / ARB_multi_draw_indirect, whose base instances the FEATURE_MULTI_DRAW variants need
+    static bool multiDrawSupported() { return glMultiDrawElementsIndirect != nullptr; }
+
+    // ObjectUniforms as per-draw attributes: model in this location and the next three, model_res in the three after
+    static const GLuint TRANSFORM_ATTRIBUTE = 6;
+
+    // per-frame statistics, call once at the end of each frame
+    void endFrame();
+
+    const GLStateCache::Stats &lastFrame() const { return frameStats; }
+
+    unsigned lastFrameDraws() const { return frameDraws; }
+
+    // draw calls the draws went out in, fewer than the draws with multi-draw
+    unsigned lastFrameCalls() const { return frameCalls; }
+
+private:
+    struct DrawItem {
+        Shader *shader;
+        const Mesh *mesh;
+        unsigned int lod;
+        bool textured;
+        glm::mat4 model;
+        glm::mat3 model_res;
+    };
+
+    std::vector<DrawItem> items;
+    std::vector<std::pair<uint64_t, uint32_t>> order;   // sort key, index into items
+    StreamBuffer *stream;
+    // ObjectUniforms of a flush in draw order, one uniform alignment apart, then the multi-draw commands
+    std::vector<char> objects;
+    std::map<MeshArena *, GLuint> multiDrawArrays;   // an arena's buffers plus the transform attributes
+    GLStateCache state;
+
+    GLStateCache::Stats frameStats;    // totals of the previous frame
+    unsigned draws = 0, frameDraws = 0;
+    unsigned calls = 0, frameCalls = 0;
+
+    static uint64_t sortKey(RenderPass pass, GLuint program, GLuint material, GLuint mesh);
+
+    void bindMaterial(const DrawItem &item, const Mesh *&current);
+
+    void drawEach(GLintptr base, size_t stride);
+
+    void drawRuns(GLintptr base, size_t stride, GLintptr commands);
+
+    // set up (once) and bind the arena's multi-draw vertex array behind the cache's back
+    void pointTransforms(MeshArena *arena, GLintptr base, size_t stride);
+};
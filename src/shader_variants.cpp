@@ -0,0 +1,57 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include "shader_variants.h"
+
+static const struct {
+    unsigned feature;
+    const char *name;
+} featureNames[] = {
+        {FEATURE_INSTANCED,     "INSTANCED"},
+        {FEATURE_TEXTURE_ARRAY, "TEXTURE_ARRAY"},
+        {FEATURE_SHADOWS,       "SHADOWS"},
+        {FEATURE_PARABOLOID,    "PARABOLOID"},
+        {FEATURE_LOCAL_LIGHTS,  "LOCAL_LIGHTS"},
+        {FEATURE_LIGHTMAP,      "LIGHTMAP"},
+        {FEATURE_GRID_SHADOW,   "GRID_SHADOW"},
+        {FEATURE_MULTI_DRAW,    "MULTI_DRAW"},
+};
+
+ShaderVariants::ShaderVariants(const char *vertexPath, const char *fragmentPath, const char *geometryPath,
+                               unsigned features, Setup setup)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : ""),
+          supported(features), setup(std::move(setup)) {}
+
+ShaderVariants::~ShaderVariants() {
+    for (auto &variant : variants) {
+        glDeleteProgram(variant.second->ID);
+        delete variant.second;
+    }
+}
+
+Shader *ShaderVariants::get(unsigned features) {
+    features &= supported;
+    auto it = variants.find(features);
+    if (it != variants.end())
+        return it->second;
+
+    auto *shader = new Shader(vertexPath.c_str(), fragmentPath.c_str(),
+                              geometryPath.empty() ? nullptr : geometryPath.c_str(), defines(features));
+    if (setup) setup(*shader);
+    variants.emplace(features, shader);
+    return shader;
+}
+
+void ShaderVariants::forEach(const std::function<void(Shader &)> &visit) {
+    for (auto &variant : variants)
+        visit(*variant.second);
+}
+
+std::string ShaderVariants::defines(unsigned features) {
+    std::string lines;
+    for (const auto &feature : featureNames)
+        if (features & feature.feature)
+            lines += std::string("#define ") + feature.name + "\n";
+    return lines;
+}
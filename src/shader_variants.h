@@ -0,0 +1,61 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include <learnopengl/shader.h>
+
+// Compile-time features of a program, each one a #define of the same name
+// without the prefix. A variant is compiled with exactly the code its
+// features need instead of branching on uniforms per vertex and fragment.
+enum ShaderFeature : unsigned {
+    FEATURE_INSTANCED = 1u << 0u,       // block batch instances instead of ObjectBlock.model
+    FEATURE_TEXTURE_ARRAY = 1u << 1u,   // diffuse from the block texture array, no specular map
+    FEATURE_SHADOWS = 1u << 2u,
+    FEATURE_PARABOLOID = 1u << 3u,      // with FEATURE_SHADOWS, the paraboloid map instead of the cubemap
+    FEATURE_LOCAL_LIGHTS = 1u << 4u,    // shade the lights of the light grid
+    FEATURE_LIGHTMAP = 1u << 5u,        // with FEATURE_INSTANCED, baked occlusion and static lights per block face
+    FEATURE_GRID_SHADOW = 1u << 6u,     // with FEATURE_SHADOWS, the shadow mask of the maze grid instead of a depth map
+    FEATURE_MULTI_DRAW = 1u << 7u,      // ObjectBlock's members from RenderQueue's per-draw attributes instead
+};
+
+// Every permutation of one set of shader files, built the first time a draw
+// asks for it and kept after that. Building goes through Shader, so with the
+// program cache a variant compiled in an earlier run only costs a binary load.
+class ShaderVariants {
+public:
+    // setup runs once on every new variant: block bindings, sampler units, constants
+    using Setup = std::function<void(Shader &)>;
+
+    // features is the set the sources know about, get() ignores any other bit
+    ShaderVariants(const char *vertexPath, const char *fragmentPath, const char *geometryPath, unsigned features,
+                   Setup setup);
+
+    ~ShaderVariants();
+
+    ShaderVariants(const ShaderVariants &) = delete;
+
+    ShaderVariants &operator=(const ShaderVariants &) = delete;
+
+    // the variant with these features, compiled on first use
+    Shader *get(unsigned features);
+
+    // visit the variants built so far, for uniforms that change after setup
+    void forEach(const std::function<void(Shader &)> &visit);
+
+    size_t built() const { return variants.size(); }
+
+    // "#define" lines for a feature set
+    static std::string defines(unsigned features);
+
+private:
+    std::string vertexPath, fragmentPath, geometryPath;
+    unsigned supported;
+    Setup setup;
+    std::unordered_map<unsigned, Shader *> variants;
+};
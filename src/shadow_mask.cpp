@@ -0,0 +1,128 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "shadow_mask.h"
+
+// the light is snapped to a quarter of a cell, moving within one keeps the mask
+static const float LIGHT_STEP = 0.5f;
+// in shadow however high, a light under the top of the walls sees nothing behind them
+static const float SHADOWED_ANY_HEIGHT = 1.0e4f;
+
+ShadowMask::ShadowMask(std::vector<uint8_t> walls, int rows, int cols, int border, float floorTop, float wallTop)
+        : walls(std::move(walls)), rows(rows), cols(cols), border(border), floorTop(floorTop), wallTop(wallTop) {
+    // cell (row, col) spans [2 row - 1, 2 row + 1] along x and the same along z with col
+    width = (rows + 2 * border) * TEXELS_PER_CELL;
+    height = (cols + 2 * border) * TEXELS_PER_CELL;
+    origin = glm::vec2(-2.0f * (float) border - 1.0f);
+    heights.assign((size_t) width * height, -SHADOWED_ANY_HEIGHT);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, heights.data());
+    // a texel never blends with the inside of a wall next to it
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+ShadowMask::~ShadowMask() {
+    glDeleteTextures(1, &texture);
+}
+
+bool ShadowMask::isWall(int row, int col) const {
+    return row >= 0 && col >= 0 && row < rows && col < cols && walls[row * cols + col];
+}
+
+float ShadowMask::shadowHeight(glm::vec2 point, glm::vec3 light) const {
+    glm::vec2 toLight = glm::vec2(light.x, light.z) - point;
+    float distance = glm::length(toLight);
+    if (distance <= 0.0f)
+        return -SHADOWED_ANY_HEIGHT;
+    glm::vec2 dir = toLight / distance;
+
+    // past this the line over a wall's top edge reaches the column below the floor
+    float reach = distance;
+    if (light.y > wallTop)
+        reach = distance * (wallTop - floorTop) / (light.y - floorTop);
+
+    // walk the cells from the point's own towards the light, in cell units where cell c is [c, c + 1)
+    glm::vec2 p = (point + 1.0f) * 0.5f;
+    glm::ivec2 cell(glm::floor(p));
+    glm::ivec2 step(0);
+    glm::vec2 next(std::numeric_limits<float>::infinity()), delta(std::numeric_limits<float>::infinity());
+    for (int a = 0; a < 2; ++a) {
+        if (dir[a] > 0.0f) {
+            step[a] = 1;
+            delta[a] = 2.0f / dir[a];
+            next[a] = ((float) cell[a] + 1.0f - p[a]) * delta[a];
+        } else if (dir[a] < 0.0f) {
+            step[a] = -1;
+            delta[a] = -2.0f / dir[a];
+            next[a] = (p[a] - (float) cell[a]) * delta[a];
+        }
+    }
+    // the point's own wall does not shade its top, its faces sample the column in front of them
+    for (;;) {
+        int a = next.x < next.y ? 0 : 1;
+        float entry = next[a];
+        if (entry >= reach)
+            return -SHADOWED_ANY_HEIGHT;
+        cell[a] += step[a];
+        next[a] += delta[a];
+        // the first wall casts the highest shadow, the ones behind it are further away
+        if (isWall(cell.x, cell.y)) {
+            if (light.y <= wallTop)
+                return SHADOWED_ANY_HEIGHT;
+            return wallTop - (light.y - wallTop) * entry / (distance - entry);
+        }
+    }
+}
+
+bool ShadowMask::update(glm::vec3 lightPos, ThreadPool &pool) {
+    glm::ivec3 lightStep(glm::floor(lightPos / LIGHT_STEP + 0.5f));
+    if (built && lightStep == builtStep)
+        return false;
+    auto start = std::chrono::steady_clock::now();
+    builtStep = lightStep;
+    built = true;
+
+    glm::vec3 light = glm::vec3(lightStep) * LIGHT_STEP;
+    float texel = 2.0f / TEXELS_PER_CELL;
+    pool.parallelFor((size_t) height, 8, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; ++z)
+            for (int x = 0; x < width; ++x) {
+                glm::vec2 point = origin + glm::vec2((float) x + 0.5f, (float) z + 0.5f) * texel;
+                heights[z * width + x] = shadowHeight(point, light);
+            }
+    });
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_FLOAT, heights.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    buildTime = elapsed.count();
+    return true;
+}
+
+void ShadowMask::setUniforms(const Shader &shader) const {
+    shader.use();
+    shader.setInt("shadowMask", SHADOW_MASK_UNIT);
+    float size = 2.0f / TEXELS_PER_CELL;
+    glUniform4f(shader.getLocation("shadowMaskArea"), origin.x, origin.y, 1.0f / (size * (float) width),
+                1.0f / (size * (float) height));
+}
+
+void ShadowMask::bind() const {
+    glActiveTexture(GL_TEXTURE0 + SHADOW_MASK_UNIT);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glActiveTexture(GL_TEXTURE0);
+}
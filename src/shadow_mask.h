@@ -0,0 +1,76 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <learnopengl/shader.h>
+
+#include "thread_pool.h"
+
+// The shadow mask is sampled by objShader.fs through unit 11, after the lightmap
+const int SHADOW_MASK_UNIT = 11;
+
+// Shadows of the UAV light worked out from the maze grid instead of a depth
+// pass. The light is always above the maze and the walls are full height
+// columns of the grid, so whether a point is lit only depends on the walls
+// between its column and the light: a 2D walk over the grid towards the light
+// finds the first wall, and the line over that wall's top edge gives the
+// height below which the column is in shadow. The mask holds that height per
+// texel of a GL_R32F texture over the floor. It is rebuilt on the thread pool,
+// and only when the light has moved by a step since the last build.
+//
+// The rebuild is always a full one. A wall's shadow reaches past it by a
+// multiple of its distance from the light, so any move of the light moves
+// the shadow of every wall in the maze. The light's reach is also far wider
+// than any level. The texels a move can change are therefore the ones with
+// a wall between them and the light, which in a maze is nearly all of them.
+// Keeping the rebuilds rare with the snapping step is the saving that is
+// left.
+class ShadowMask {
+public:
+    static const int TEXELS_PER_CELL = 8;
+
+    // walls[row * cols + col] over the maze, the mask also covers border cells of floor around it;
+    // floorTop and wallTop are the heights of the floor and of the top of the walls
+    ShadowMask(std::vector<uint8_t> walls, int rows, int cols, int border, float floorTop, float wallTop);
+
+    ~ShadowMask();
+
+    ShadowMask(const ShadowMask &) = delete;
+
+    ShadowMask &operator=(const ShadowMask &) = delete;
+
+    // rebuild for a light at lightPos if it is a step away from the last build, returns whether it was
+    bool update(glm::vec3 lightPos, ThreadPool &pool);
+
+    // mask uniforms of a program that samples it
+    void setUniforms(const Shader &shader) const;
+
+    void bind() const;
+
+    // CPU time of the last rebuild, walking and upload
+    double buildMilliseconds() const { return buildTime; }
+
+private:
+    std::vector<uint8_t> walls;
+    int rows, cols, border;
+    float floorTop, wallTop;
+
+    int width, height;
+    glm::vec2 origin;   // corner of the first texel
+    std::vector<float> heights;
+    glm::ivec3 builtStep{0};
+    bool built = false;
+    double buildTime = 0.0;
+    GLuint texture = 0;
+
+    bool isWall(int row, int col) const;
+
+    float shadowHeight(glm::vec2 point, glm::vec3 light) const;
+};
@@ -0,0 +1,7 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "stb_image_write.h"
@@ -0,0 +1,113 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "stream_buffer.h"
+
+StreamBuffer::StreamBuffer(GLsizeiptr frameSize) : regionSize(frameSize) {
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformOffsetAlignment);
+    create();
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (GLsync &fence : fences)
+        if (fence) glDeleteSync(fence);
+    if (!retired.empty())
+        glDeleteBuffers((GLsizei) retired.size(), retired.data());
+    glDeleteBuffers(1, &ID);
+}
+
+void StreamBuffer::create() {
+    GLsizeiptr size = regionSize * FRAMES;
+    glGenBuffers(1, &ID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+    mapped = nullptr;
+    if (glBufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        mapped = (char *) glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+        if (!mapped) {
+            std::cerr << "Failed to map the stream buffer" << std::endl;
+            exit(-1);
+        }
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamBuffer::grow(GLsizeiptr needed) {
+    // draws already recorded keep reading the old buffer, delete it once they are submitted
+    retired.push_back(ID);
+    for (GLsync &fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    regionSize = std::max(regionSize * 2, needed * 2);
+    create();
+    region = 0;
+    head = 0;
+    ++generations;
+}
+
+void StreamBuffer::beginFrame() {
+    if (!retired.empty()) {
+        glDeleteBuffers((GLsizei) retired.size(), retired.data());
+        retired.clear();
+    }
+
+    region = (region + 1) % FRAMES;
+    head = 0;
+    frameBytes = 0;
+    GLsync &fence = fences[region];
+    if (!fence) return;
+    // normally signalled long ago, only a GPU running FRAMES frames behind makes us wait
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        ++fenceWaits;
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::endFrame() {
+    if (fences[region]) glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLintptr StreamBuffer::write(const void *data, GLsizeiptr size, GLsizeiptr alignment) {
+    GLintptr base = region * regionSize;
+    GLintptr offset = (base + head + alignment - 1) / alignment * alignment;
+    if (offset + size > base + regionSize) {
+        grow(size + alignment);
+        base = 0;
+        offset = 0;
+    }
+
+    if (size > 0) {
+        if (mapped) {
+            std::memcpy(mapped + offset, data, size);
+        } else {
+            // the fence of this region guarantees the GPU is done with it, no need to synchronise
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            void *target = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                            GL_MAP_UNSYNCHRONIZED_BIT);
+            std::memcpy(target, data, size);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+    }
+    head = offset - base + size;
+    frameBytes += size;
+    return offset;
+}
+
+void StreamBuffer::bindUniformBlock(GLuint binding, const void *data, GLsizeiptr size) {
+    GLintptr offset = write(data, size, uniformOffsetAlignment);
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, ID, offset, size);
+}
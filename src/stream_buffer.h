@@ -0,0 +1,83 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "glext.h"
+
+// One buffer object split into FRAMES regions that are written in turn, one
+// per frame, for everything the CPU regenerates every frame: uniform blocks,
+// per-draw transforms, HUD vertices and the light grid. A region is fenced
+// when its frame has been submitted and only waited on when the ring comes
+// back to it, so with three regions the CPU runs up to two frames ahead
+// without ever synchronising on a buffer the GPU still reads.
+//
+// With GL 4.4 / ARB_buffer_storage the buffer is mapped once, persistently and
+// coherently, and writes are plain memcpys. Otherwise each write maps its range
+// unsynchronized, which the fences make just as safe.
+class StreamBuffer {
+public:
+    static const int FRAMES = 3;
+
+    explicit StreamBuffer(GLsizeiptr frameSize);
+
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer &) = delete;
+
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    // move to the next region, call before the first write of a frame
+    void beginFrame();
+
+    // fence the region written since beginFrame(), call after the last draw of the frame
+    void endFrame();
+
+    // copy size bytes to an offset that is a multiple of alignment, returns the offset;
+    // a frame that outgrows its region moves the ring to a bigger buffer
+    GLintptr write(const void *data, GLsizeiptr size, GLsizeiptr alignment);
+
+    // write a std140 block and bind it to a uniform buffer binding point
+    void bindUniformBlock(GLuint binding, const void *data, GLsizeiptr size);
+
+    template<typename T>
+    void bindUniformBlock(GLuint binding, const T &block) {
+        bindUniformBlock(binding, &block, sizeof(T));
+    }
+
+    GLuint buffer() const { return ID; }
+
+    // bumped when a write moved the ring to a new buffer, vertex arrays pointing at it must be set up again
+    unsigned generation() const { return generations; }
+
+    GLint uniformAlignment() const { return uniformOffsetAlignment; }
+
+    bool persistent() const { return mapped != nullptr; }
+
+    GLsizeiptr lastFrameBytes() const { return frameBytes; }
+
+    // times beginFrame() found its region still in use and had to wait, 0 unless the GPU is FRAMES frames behind
+    unsigned waits() const { return fenceWaits; }
+
+private:
+    GLuint ID = 0;
+    GLsizeiptr regionSize;
+    char *mapped = nullptr;     // the whole buffer, when persistently mapped
+    GLsync fences[FRAMES]{};
+    int region = FRAMES - 1;
+    GLsizeiptr head = 0;        // next free byte of the current region
+    GLsizeiptr frameBytes = 0;
+    unsigned generations = 0;
+    unsigned fenceWaits = 0;
+    GLint uniformOffsetAlignment = 256;
+    std::vector<GLuint> retired;    // replaced buffers, still referenced by this frame's bindings
+
+    void create();
+
+    void grow(GLsizeiptr needed);
+};
@@ -4,70 +4,267 @@
 #include <ft2build.h>
 #include <glm/ext.hpp>
 #include FT_FREETYPE_H
+#include <cmath>
+#include <cstring>
 
 #include "text.h"
 
 
 
-FreeType::FreeType(const char *filename) {
+namespace {
+
+const float DISTANCE_INFINITY = 1e20f;
+
+// Felzenszwalb & Huttenlocher: squared distance transform of one row or column in place
+void distanceTransform1D(float *f, int n, int stride, std::vector<float> &d, std::vector<int> &v,
+                         std::vector<float> &z) {
+    int k = 0;
+    v[0] = 0;
+    z[0] = -DISTANCE_INFINITY;
+    z[1] = DISTANCE_INFINITY;
+    for (int q = 1; q < n; q++) {
+        float s;
+        while (true) {
+            int r = v[k];
+            s = ((f[q * stride] + q * q) - (f[r * stride] + r * r)) / (2.0f * (q - r));
+            if (s > z[k] || k == 0) break;
+            k--;
+        }
+        if (s <= z[k]) s = z[k];
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = DISTANCE_INFINITY;
+    }
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) k++;
+        int r = v[k];
+        d[q] = (float) ((q - r) * (q - r)) + f[r * stride];
+    }
+    for (int q = 0; q < n; q++) f[q * stride] = d[q];
+}
+
+// squared distance of every pixel to the nearest pixel where feature is set
+std::vector<float> distanceTransform(const std::vector<bool> &feature, int width, int height) {
+    std::vector<float> grid(width * height);
+    for (int i = 0; i < width * height; i++) grid[i] = feature[i] ? 0.0f : DISTANCE_INFINITY;
+    int n = std::max(width, height);
+    std::vector<float> d(n), z(n + 1);
+    std::vector<int> v(n);
+    for (int x = 0; x < width; x++) distanceTransform1D(&grid[x], height, width, d, v, z);
+    for (int y = 0; y < height; y++) distanceTransform1D(&grid[y * width], width, 1, d, v, z);
+    return grid;
+}
+
+// Turns a glyph rendered at oversample times the atlas size into a signed distance field
+// with spread pixels of margin. 0.5 is the outline, larger values are inside.
+std::vector<unsigned char> signedDistanceField(const FT_Bitmap &bitmap, int oversample, int spread,
+                                               int &width, int &height) {
+    int margin = spread * oversample;
+    width = ((int) bitmap.width + 2 * margin + oversample - 1) / oversample;
+    height = ((int) bitmap.rows + 2 * margin + oversample - 1) / oversample;
+    int fineWidth = width * oversample, fineHeight = height * oversample;
+
+    std::vector<bool> inside(fineWidth * fineHeight, false), outside(fineWidth * fineHeight, true);
+    for (int y = 0; y < (int) bitmap.rows; y++) {
+        for (int x = 0; x < (int) bitmap.width; x++) {
+            if (bitmap.buffer[y * bitmap.pitch + x] >= 128) {
+                int i = (y + margin) * fineWidth + x + margin;
+                inside[i] = true;
+                outside[i] = false;
+            }
+        }
+    }
+    std::vector<float> toInside = distanceTransform(inside, fineWidth, fineHeight);
+    std::vector<float> toOutside = distanceTransform(outside, fineWidth, fineHeight);
+
+    std::vector<unsigned char> field(width * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int i = (y * oversample + oversample / 2) * fineWidth + x * oversample + oversample / 2;
+            // distances run between pixel centres, the edge lies half a pixel away
+            float distance = inside[i] ? std::sqrt(toOutside[i]) - 0.5f : -(std::sqrt(toInside[i]) - 0.5f);
+            float value = 0.5f + distance / oversample / (2.0f * spread);
+            field[y * width + x] = (unsigned char) (std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+    return field;
+}
+
+}
+
+// decode one UTF-8 sequence starting at text[i], malformed input becomes U+FFFD
+static uint32_t nextCodepoint(const std::string &text, size_t &i) {
+    auto lead = (uint8_t) text[i++];
+    if (lead < 0x80) return lead;
+    int extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : -1;
+    if (extra < 0 || lead >= 0xF8) return 0xFFFD;
+    uint32_t codepoint = lead & (0x3F >> extra);
+    for (int k = 0; k < extra; k++) {
+        if (i >= text.size() || ((uint8_t) text[i] & 0xC0) != 0x80) return 0xFFFD;
+        codepoint = (codepoint << 6) | ((uint8_t) text[i++] & 0x3F);
+    }
+    return codepoint;
+}
+
+FreeType::FreeType(const char *filename, StreamBuffer *stream, GlyphMode mode) : mode(mode), stream(stream) {
+    s.use();
+    s.setInt("text", 0);
+    s.setInt("sdf", mode == GlyphMode::SDF);
+
     glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, nullptr, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), nullptr);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    setupVertexArray(VAO, stream->buffer());
+    vaoGeneration = stream->generation();
 
-    FT_Library ft;
-    if (FT_Init_FreeType(&ft)) {
+    if (FT_Init_FreeType(&library)) {
         std::cerr << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
         exit(-1);
     }
 
-    FT_Face face;
-    if (FT_New_Face(ft, filename, 0, &face)) {
+    if (FT_New_Face(library, filename, 0, &face)) {
         std::cerr << "ERROR::FREETYPE: Failed to load font" << std::endl;
         exit(-1);
     }
 
-    FT_Set_Pixel_Sizes(face, 0, 48);
+    // 距离场在更细的栅格上量, 再按 SDF_OVERSAMPLE 缩回图集尺寸
+    int rasterSize = mode == GlyphMode::SDF ? SDF_PIXEL_SIZE * SDF_OVERSAMPLE : FONT_PIXEL_SIZE;
+    rasterScale = mode == GlyphMode::SDF ? 1.0f / SDF_OVERSAMPLE : 1.0f;
+    glyphScale = mode == GlyphMode::SDF ? (float) FONT_PIXEL_SIZE / SDF_PIXEL_SIZE : 1.0f;
+    FT_Set_Pixel_Sizes(face, 0, rasterSize);
 
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // 字形在第一次用到时才栅格化, 这里只分配空的图集页
+    std::vector<unsigned char> empty(PAGE_SIZE * PAGE_SIZE * PAGE_COUNT, 0);
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, PAGE_SIZE, PAGE_SIZE, PAGE_COUNT, 0, GL_RED, GL_UNSIGNED_BYTE,
+                 empty.data());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+FreeType::~FreeType() {
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+}
+
+const Character *FreeType::glyph(uint32_t codepoint) {
+    auto found = Characters.find(codepoint);
+    if (found != Characters.end()) return &found->second;
 
-    for (GLubyte c = 0; c < 128; c++) {
-        if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-            std::cerr << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-            continue;
+    if (FT_Load_Char(face, codepoint, FT_LOAD_RENDER)) {
+        std::cerr << "ERROR::FREETYTPE: Failed to load Glyph " << codepoint << std::endl;
+        return nullptr;
+    }
+    FT_Bitmap &bitmap = face->glyph->bitmap;
+    int w, h;
+    std::vector<unsigned char> pixels;
+    glm::vec2 bearing(face->glyph->bitmap_left * rasterScale, face->glyph->bitmap_top * rasterScale);
+    if (bitmap.width == 0 || bitmap.rows == 0) {
+        w = h = 0;
+    } else if (mode == GlyphMode::SDF) {
+        pixels = signedDistanceField(bitmap, SDF_OVERSAMPLE, SDF_SPREAD, w, h);
+        bearing += glm::vec2(-SDF_SPREAD, SDF_SPREAD);
+    } else {
+        w = bitmap.width;
+        h = bitmap.rows;
+        pixels.resize(w * h);
+        for (int row = 0; row < h; row++)
+            std::memcpy(&pixels[row * w], bitmap.buffer + row * bitmap.pitch, w);
+    }
+
+    Character ch{};
+    ch.Size = glm::vec2(w, h);
+    ch.Bearing = bearing;
+    // 位图模式保持原来按整像素前进的排版
+    ch.Advance = mode == GlyphMode::SDF ? face->glyph->advance.x / 64.0f * rasterScale
+                                        : (float) (face->glyph->advance.x >> 6);
+    ch.Page = -1;
+    if (w > 0 && h > 0) {
+        glm::ivec2 origin;
+        ch.Page = allocate(w, h, origin);
+        if (ch.Page < 0) {
+            std::cerr << "ERROR::FREETYTPE: Glyph " << codepoint << " does not fit an atlas page" << std::endl;
+            return nullptr;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, origin.x, origin.y, ch.Page, w, h, 1, GL_RED, GL_UNSIGNED_BYTE,
+                        pixels.data());
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        ch.Region = glm::vec4((float) origin.x / PAGE_SIZE, (float) origin.y / PAGE_SIZE,
+                              (float) (origin.x + w) / PAGE_SIZE, (float) (origin.y + h) / PAGE_SIZE);
+        pages[ch.Page].codepoints.push_back(codepoint);
+    }
+    return &(Characters[codepoint] = ch);
+}
+
+int FreeType::allocate(int w, int h, glm::ivec2 &origin) {
+    if (w + 2 * PADDING > PAGE_SIZE || h + 2 * PADDING > PAGE_SIZE) return -1;
+    // 先在已有的行里找位置, 再开新行
+    for (int i = 0; i < PAGE_COUNT; i++) {
+        Page &page = pages[i];
+        int x = page.penX, y = page.penY;
+        if (x + w + PADDING > PAGE_SIZE) {
+            x = PADDING;
+            y += page.rowHeight + PADDING;
         }
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RED,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-        );
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        Characters.insert(std::pair<GLchar, Character>(c, Character {
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                face->glyph->advance.x
-        }));
+        if (y + h + PADDING > PAGE_SIZE) continue;
+        if (y != page.penY) page.rowHeight = 0;
+        origin = glm::ivec2(x, y);
+        page.penX = x + w + PADDING;
+        page.penY = y;
+        page.rowHeight = std::max(page.rowHeight, h);
+        page.lastUse = ++useClock;
+        return i;
+    }
+
+    // 所有页都满了: 清空最久没用的那一页, 等着画的顶点还在用的页除外
+    int victim = -1;
+    for (int i = 0; i < PAGE_COUNT; i++) {
+        if (pendingPages & (1u << i)) continue;
+        if (victim < 0 || pages[i].lastUse < pages[victim].lastUse) victim = i;
     }
+    if (victim < 0) return -1;
+    evict(victim);
+    return allocate(w, h, origin);
+}
+
+void FreeType::evict(int index) {
+    Page &page = pages[index];
+    for (uint32_t codepoint : page.codepoints)
+        Characters.erase(codepoint);
+    page = Page();
+    // 清掉旧像素, 否则新字形的边缘会滤到旧字形
+    std::vector<unsigned char> empty(PAGE_SIZE * PAGE_SIZE, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, index, PAGE_SIZE, PAGE_SIZE, 1, GL_RED, GL_UNSIGNED_BYTE,
+                    empty.data());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    ++evictions;
+}
+
+void FreeType::touchPages(uint32_t mask) {
+    ++useClock;
+    for (int i = 0; i < PAGE_COUNT; i++)
+        if (mask & (1u << i)) pages[i].lastUse = useClock;
+}
+
+void FreeType::setupVertexArray(GLuint vao, GLuint vbo) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), nullptr);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), (void *) offsetof(GlyphVertex, r));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), (void *) offsetof(GlyphVertex, page));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 }
 
 void FreeType::use() const {
@@ -78,45 +275,68 @@ void FreeType::setMat4(const std::string &name, const glm::mat4 &mat) const {
     s.setMat4(name, mat);
 }
 
-void FreeType::renderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color) {
-    // 激活对应的渲染状态
+void FreeType::renderText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color) {
+    // 只在 CPU 上累积顶点, 由 flush() 一次画完
+    pendingPages |= layoutText(text, x, y, scale, color, vertices);
+}
+
+uint32_t FreeType::layoutText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color,
+                              std::vector<GlyphVertex> &out) {
+    uint32_t used = 0;
+    for (size_t i = 0; i < text.size();) {
+        const Character *glyph = this->glyph(nextCodepoint(text, i));
+        if (!glyph) continue;
+        const Character &ch = *glyph;
+
+        GLfloat unit = scale * glyphScale;
+        GLfloat xpos = x + ch.Bearing.x * unit;
+        GLfloat ypos = y - (ch.Size.y - ch.Bearing.y) * unit;
+
+        GLfloat w = ch.Size.x * unit;
+        GLfloat h = ch.Size.y * unit;
+        // 空白字符没有位图, 只前进
+        if (ch.Page >= 0) {
+            GLfloat u0 = ch.Region.x, v0 = ch.Region.y, u1 = ch.Region.z, v1 = ch.Region.w;
+            auto page = (GLfloat) ch.Page;
+            GlyphVertex quad[6] = {
+                    {xpos,     ypos + h, u0, v0, color.x, color.y, color.z, page},
+                    {xpos,     ypos,     u0, v1, color.x, color.y, color.z, page},
+                    {xpos + w, ypos,     u1, v1, color.x, color.y, color.z, page},
+
+                    {xpos,     ypos + h, u0, v0, color.x, color.y, color.z, page},
+                    {xpos + w, ypos,     u1, v1, color.x, color.y, color.z, page},
+                    {xpos + w, ypos + h, u1, v0, color.x, color.y, color.z, page}
+            };
+            out.insert(out.end(), quad, quad + 6);
+            used |= 1u << ch.Page;
+        }
+        // 更新位置到下一个字形的原点
+        x += ch.Advance * unit;
+    }
+    touchPages(used);
+    return used;
+}
+
+void FreeType::drawVertices(GLuint vao, unsigned &streamGeneration, const std::vector<GlyphVertex> &batch) const {
+    if (batch.empty()) return;
+    // 顶点写进本帧的环形缓冲区, 起始位置是顶点大小的整数倍, 可以直接作为 first
+    GLintptr offset = stream->write(batch.data(), batch.size() * sizeof(GlyphVertex), sizeof(GlyphVertex));
+    if (streamGeneration != stream->generation()) {
+        setupVertexArray(vao, stream->buffer());
+        streamGeneration = stream->generation();
+    }
     s.use();
-    glUniform3f(glGetUniformLocation(s.ID, "textColor"), color.x, color.y, color.z);
     glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO);
-
-    // 遍历文本中所有的字符
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
-    {
-        Character ch = Characters[*c];
-
-        GLfloat xpos = x + ch.Bearing.x * scale;
-        GLfloat ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-
-        GLfloat w = ch.Size.x * scale;
-        GLfloat h = ch.Size.y * scale;
-        // 对每个字符更新VBO
-        GLfloat vertices[6][4] = {
-                { xpos,     ypos + h,   0.0, 0.0 },
-                { xpos,     ypos,       0.0, 1.0 },
-                { xpos + w, ypos,       1.0, 1.0 },
-
-                { xpos,     ypos + h,   0.0, 0.0 },
-                { xpos + w, ypos,       1.0, 1.0 },
-                { xpos + w, ypos + h,   1.0, 0.0 }
-        };
-        // 在四边形上绘制字形纹理
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // 更新VBO内存的内容
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // 绘制四边形
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        // 更新位置到下一个字形的原点，注意单位是1/64像素
-        x += (ch.Advance >> 6) * scale; // 位偏移6个单位来获取单位为像素的值 (2^6 = 64)
-    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas);
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, (GLint) (offset / sizeof(GlyphVertex)), (GLsizei) batch.size());
     glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void FreeType::flush() {
+    if (vertices.empty()) return;
+    drawVertices(VAO, vaoGeneration, vertices);
+    vertices.clear();
+    pendingPages = 0;
 }
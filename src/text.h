@@ -6,26 +6,103 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
-#include <learnopengl/shader_m.h>
-#include <map>
+#include <learnopengl/shader.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "stream_buffer.h"
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+// 图集里存的是什么
+enum class GlyphMode {
+    BITMAP,   // 48 像素的覆盖率位图, 缩放后会模糊
+    SDF       // 32 像素的有向距离场, 任意缩放都保持锐利
+};
 
 struct Character {
-    GLuint TextureID;  // 字形纹理的ID
-    glm::ivec2 Size;       // 字形大小
-    glm::ivec2 Bearing;    // 从基准线到字形左部/顶部的偏移值
-    long Advance;    // 原点距下一个字形原点的距离
+    int Page;              // 所在的图集页
+    glm::vec4 Region;      // 字形在图集中的纹理坐标 (u0, v0, u1, v1)
+    glm::vec2 Size;        // 字形大小 (图集像素)
+    glm::vec2 Bearing;     // 从基准线到字形左部/顶部的偏移值
+    float Advance;         // 原点距下一个字形原点的距离 (像素)
+};
+
+// 一个文字顶点: 屏幕位置, 图集坐标, 颜色
+struct GlyphVertex {
+    GLfloat x, y, u, v;
+    GLfloat r, g, b;
+    GLfloat page;
 };
 
+// Glyphs are rasterised on first use, keyed by codepoint, into the pages of one
+// texture array. When every page is full the least recently used page is
+// emptied and its glyphs are rasterised again when next needed; generation()
+// tells callers that kept laid out quads that theirs may be stale.
+// renderText only appends quads on the CPU, flush() streams them and draws
+// every string of the frame at once. Text is UTF-8.
 class FreeType {
 public:
     FreeType() = delete;
-    explicit FreeType(const char* filename);
-    void renderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
+    FreeType(const char* filename, StreamBuffer *stream, GlyphMode mode = GlyphMode::SDF);
+    void renderText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color);
+    void flush();
+    // append the quads of a string to out, for callers that keep their own geometry;
+    // returns the mask of atlas pages the quads sample
+    uint32_t layoutText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color,
+                        std::vector<GlyphVertex> &out);
+    // mark pages as in use so they are the last to be evicted
+    void touchPages(uint32_t pages);
+    // bumped whenever a page is evicted
+    unsigned generation() const { return evictions; }
+    // GlyphVertex attribute layout on a vertex array of the caller
+    static void setupVertexArray(GLuint vao, GLuint vbo);
+    // write a batch of vertices to this frame's stream region and draw them with the atlas bound;
+    // vao is pointed at the stream buffer again when streamGeneration is out of date
+    void drawVertices(GLuint vao, unsigned &streamGeneration, const std::vector<GlyphVertex> &batch) const;
     void setMat4(const std::string &name, const glm::mat4 &mat) const;
     void use() const;
 
+    ~FreeType();
+
 private:
-    GLuint VAO{}, VBO{};
+    static const int PAGE_SIZE = 512;
+    static const int PAGE_COUNT = 4;
+    static const int PADDING = 1;   // 字形之间留 1 像素避免线性过滤串色
+    // layout keeps working in the units of the original 48 px font
+    static const int FONT_PIXEL_SIZE = 48;
+    static const int SDF_PIXEL_SIZE = 32;
+    static const int SDF_OVERSAMPLE = 4;    // the distance is measured on a raster this much finer
+    static const int SDF_SPREAD = 4;        // distance range encoded around the edge, in atlas pixels
+
+    GlyphMode mode;
+    float glyphScale;   // FONT_PIXEL_SIZE units per atlas pixel
+    float rasterScale;  // atlas pixels per rasterised pixel
+
+    // one shelf packed layer of the atlas
+    struct Page {
+        int penX = PADDING, penY = PADDING, rowHeight = 0;
+        uint64_t lastUse = 0;
+        std::vector<uint32_t> codepoints;
+    };
+
+    const Character *glyph(uint32_t codepoint);
+    int allocate(int w, int h, glm::ivec2 &origin);
+    void evict(int page);
+
+    StreamBuffer *stream;
+    GLuint VAO{};
+    unsigned vaoGeneration;
+    GLuint atlas{};
     Shader s = Shader("res/text.vs", "res/text.fs");
-    std::map<uint8_t, Character> Characters;
-};
\ No newline at end of file
+    FT_LibraryRec_ *library = nullptr;
+    FT_FaceRec_ *face = nullptr;
+    std::unordered_map<uint32_t, Character> Characters;
+    Page pages[PAGE_COUNT];
+    uint64_t useClock = 0;
+    unsigned evictions = 0;
+    std::vector<GlyphVertex> vertices;
+    uint32_t pendingPages = 0;  // pages sampled by vertices, never evicted before flush()
+};
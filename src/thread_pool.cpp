@@ -0,0 +1,72 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#include <algorithm>
+
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    for (unsigned i = 1; i < std::max(threads, 1u); ++i)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::runChunks() {
+    size_t chunks = (jobCount + jobGrain - 1) / jobGrain;
+    for (size_t chunk = nextChunk++; chunk < chunks; chunk = nextChunk++) {
+        size_t begin = chunk * jobGrain;
+        (*job)(begin, std::min(begin + jobGrain, jobCount));
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &task) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    // not worth waking anybody for a single chunk
+    if (workers.empty() || count <= grain) {
+        task(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &task;
+        jobCount = count;
+        jobGrain = grain;
+        nextChunk = 0;
+        ++jobGeneration;
+    }
+    wake.notify_all();
+
+    runChunks();
+
+    // every chunk has been handed out, wait for the workers still running one
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::work() {
+    unsigned long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || (job && jobGeneration != seen); });
+        if (stopping) return;
+        seen = jobGeneration;
+        ++busy;
+        lock.unlock();
+        runChunks();
+        lock.lock();
+        if (--busy == 0) finished.notify_one();
+    }
+}
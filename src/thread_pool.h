@@ -0,0 +1,51 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads for the data parallel part of a frame. parallelFor() cuts a
+// range into chunks, runs them on the workers and on the calling thread, and
+// returns once every chunk is done, so the caller may touch the results (and
+// GL) right after. Only the thread that owns the pool calls parallelFor().
+class ThreadPool {
+public:
+    // threads including the caller, at least one
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned size() const { return (unsigned) workers.size() + 1; }
+
+    // task(begin, end) for consecutive chunks of at most grain items covering [0, count)
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &task);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    bool stopping = false;
+
+    // the running job, only replaced while no worker is inside it
+    const std::function<void(size_t, size_t)> *job = nullptr;
+    size_t jobCount = 0, jobGrain = 1;
+    unsigned long jobGeneration = 0;
+    std::atomic<size_t> nextChunk{0};
+    unsigned busy = 0;      // workers inside the current job
+
+    void runChunks();
+
+    void work();
+};
@@ -0,0 +1,44 @@
+//
+// Created by light on 10/18/2026.
+//
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// CPU mirrors of the std140 uniform blocks shared by the scene, depth and
+// paraboloid depth shaders and lightCubeShader. Members are ordered so the
+// C++ layout matches std140 without manual padding; keep them in sync with res/*.
+
+enum UniformBinding {
+    FRAME_BLOCK_BINDING = 0,
+    LIGHT_BLOCK_BINDING = 1,
+    OBJECT_BLOCK_BINDING = 2
+};
+
+// changes once per frame
+struct FrameUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec4 viewPos;      // xyz
+    float far_plane;
+    float bakedLightScale;  // scales the static lights baked into the lightmap
+    float padding[2];
+};
+
+// changes once per frame per light
+struct LightUniforms {
+    glm::mat4 shadowMatrices[6];
+    glm::mat4 lightView;
+    glm::vec4 position;     // xyz
+    glm::vec4 ambient;      // rgb
+    glm::vec4 diffuse;      // rgb
+    glm::vec4 specular;     // rgb
+    glm::vec4 attenuation;  // constant, linear, quadratic
+};
+
+// changes per draw, every draw binds its own range of the stream buffer
+struct ObjectUniforms {
+    glm::mat4 model;
+    glm::mat4 model_res;    // a std140 mat3 is three vec4 columns, the fourth column is padding
+};
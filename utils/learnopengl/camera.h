@@ -172,7 +172,7 @@ public:
     }
 
     // Compare good point distance with wished
-    glm::vec3 getMovedPos(const Maze* maze, double maze_blk_sz, glm::vec3 dir, glm::vec3 wishPos, float velocity) {
+    glm::vec3 getMovedPos(const Maze* maze, double maze_blk_sz, glm::vec3 dir, glm::vec3 wishPos, float /*velocity*/) {
         glm::vec3 goodP = collideIfAny(maze, maze_blk_sz, dir);
         if (goodP.y < 0) {
             // no collision
@@ -189,7 +189,6 @@ public:
     glm::vec3 collideIfAny(const Maze* maze, double maze_blk_sz, glm::vec3 dir) {
         bool collided = false;
         double tmin = std::numeric_limits<double>::max();
-        int imin = 999, jmin = 999;
         // A ray
         glm::vec3 ray_orig(position.x, 0, position.z);
         glm::vec3 ray_dir(dir.x, 0, dir.z); // only look in 2D dimension, to make searching faster
@@ -230,8 +229,6 @@ public:
                     collided = true;
                     if (tcur < tmin) {
                         tmin = tcur;
-                        imin = i;
-                        jmin = j;
                     }
                 }
             }
@@ -241,62 +238,48 @@ public:
         }
         glm::vec3 crossPt = ray_orig + ray_dir * (float)(tmin + goOut * 0.32f);
         crossPt.y = position.y;
-//        printf("Pointing at (%d, %d)!\n", imin, jmin);
         return crossPt;
     }
 
     // Retrieve the maze block pointed at
     int* getPointAt(const Maze* maze, double maze_blk_sz) {
-        bool collided = false;
-        double tmin = std::numeric_limits<double>::max();
-        int collPt[3] = {-999, -999, -999};
-        // A ray
-        glm::vec3 ray_orig = position;
-        glm::vec3 ray_dir = front;
-        // Search all cubes
-        for (int i = 0; i < maze->get_row_num(); ++i) {
-            for (int j = 0; j < maze->get_col_num(); ++j) {
-                for (int _ = 0; _ < 5; ++_) {
-                    if (!maze->isWall(i, j)) continue;
-                    // A cube
-                    double half_maze_blk_sz = maze_blk_sz / 2;
-                    glm::vec3 pmin(i * maze_blk_sz - half_maze_blk_sz, maze_blk_sz * _ - half_maze_blk_sz, j * maze_blk_sz - half_maze_blk_sz);
-                    glm::vec3 pmax(i * maze_blk_sz + half_maze_blk_sz, maze_blk_sz * _ + half_maze_blk_sz, j * maze_blk_sz + half_maze_blk_sz);
-                    // Whether they collide? p + td = X --> t = (X - p) / d
-                    double ts[6];
-                    ts[0] = (pmin.x - ray_orig.x) / ray_dir.x;
-                    ts[1] = (pmax.x - ray_orig.x) / ray_dir.x;
-                    ts[2] = (pmin.y - ray_orig.y) / ray_dir.y;
-                    ts[3] = (pmax.y - ray_orig.y) / ray_dir.y;
-                    ts[4] = (pmin.z - ray_orig.z) / ray_dir.z;
-                    ts[5] = (pmax.z - ray_orig.z) / ray_dir.z;
-                    for (double tcur : ts) {
-                        // check if t is valid
-                        if (tcur < 0) continue;
-                        glm::vec3 res = ray_orig + ray_dir * (float)tcur;
-                        if (res.x < pmin.x || res.x > pmax.x ||
-                            res.y < pmin.y || res.y > pmax.y ||
-                            res.z < pmin.z || res.z > pmax.z) {
-                            // invalid
-                            continue;
-                        }
-                        // valid, find smallest
-                        collided = true;
-                        if (tcur < tmin) {
-                            tmin = tcur;
-                            collPt[0] = i;
-                            collPt[1] = _;
-                            collPt[2] = j;
-                        }
-                    }
-                }
+        // Walk the blocks the ray passes through in order (Amanatides & Woo), the first
+        // wall block is the nearest one hit; block c spans [c - 1/2, c + 1/2] block sizes
+        const int layers = 5;
+        glm::ivec3 size(maze->get_row_num(), layers, maze->get_col_num());
+        glm::vec3 p = position / (float)maze_blk_sz + 0.5f;
+        glm::ivec3 cell(glm::floor(p));
+        glm::ivec3 step(0);
+        glm::vec3 next(std::numeric_limits<float>::infinity()), delta(std::numeric_limits<float>::infinity());
+        for (int a = 0; a < 3; ++a) {
+            if (front[a] > 0.0f) {
+                step[a] = 1;
+                delta[a] = 1.0f / front[a];
+                next[a] = ((float)cell[a] + 1.0f - p[a]) * delta[a];
+            } else if (front[a] < 0.0f) {
+                step[a] = -1;
+                delta[a] = -1.0f / front[a];
+                next[a] = (p[a] - (float)cell[a]) * delta[a];
             }
         }
-        if (!collided) {
-            return new int[3]{0, -10, 0};    // no collision
+        for (;;) {
+            bool inside = true;
+            for (int a = 0; a < 3; ++a) {
+                if (cell[a] >= 0 && cell[a] < size[a]) continue;
+                inside = false;
+                // outside the maze and not heading back in, nothing left to hit
+                if (step[a] == 0 || (cell[a] < 0) == (step[a] < 0)) {
+                    return new int[3]{0, -10, 0};    // no collision
+                }
+            }
+            if (inside && maze->isWall(cell.x, cell.z)) {
+//                printf("Pointing at (%d, %d, %d)!\n", cell.x, cell.y, cell.z);
+                return new int[3]{cell.x, cell.y, cell.z};
+            }
+            int a = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+            cell[a] += step[a];
+            next[a] += delta[a];
         }
-//        printf("Pointing at (%d, %d, %d)!\n", collPt[0], collPt[1], collPt[2]);
-        return new int[3]{collPt[0], collPt[1], collPt[2]};
     }
 
     void changeSpeed(float _speed) {
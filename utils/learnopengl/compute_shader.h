@@ -0,0 +1,40 @@
+#ifndef COMPUTE_SHADER_H
+#define COMPUTE_SHADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+
+#include "shader.h"
+
+// not in a GL 3.x glad build
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+
+// A program with a single compute stage, needs GL 4.3 / ARB_compute_shader.
+// Loading, error checks, the program store and the uniform cache are Shader's;
+// dispatching is up to the caller, whose loader provides glDispatchCompute.
+class ComputeShader : public Shader
+{
+public:
+    // constructor reads and compiles the shader, through Shader::programStore when set
+    // ------------------------------------------------------------------------
+    ComputeShader(const char* computePath)
+    {
+        std::string computeCode = readFile(computePath);
+        build({{GL_COMPUTE_SHADER, "COMPUTE", computeCode}}, "//compute\n" + computeCode);
+    }
+    // ------------------------------------------------------------------------
+    void setUInt(const std::string &name, unsigned int value) const
+    {
+        glUniform1ui(getLocation(name), value);
+    }
+    // ------------------------------------------------------------------------
+    void setVec4Array(const std::string &name, const glm::vec4 *values, int count) const
+    {
+        glUniform4fv(getLocation(name), count, &values[0][0]);
+    }
+};
+#endif
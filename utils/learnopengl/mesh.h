@@ -5,13 +5,22 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <learnopengl/mesh_arena.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplify.h>
 #include <learnopengl/shader.h>
 
 #include <string>
 #include <vector>
 using namespace std;
 
+// GL 3.3 core, newer than the glad profile we generate
+#ifndef GL_INT_2_10_10_10_REV
+#define GL_INT_2_10_10_10_REV 0x8D9F
+#endif
+
 struct Vertex {
     // position
     glm::vec3 Position;
@@ -25,6 +34,28 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// how a mesh lays out its vertices on the GPU
+enum class VertexFormat {
+    // position, normal, uv, tangent, bitangent as floats: 56 bytes in one stream
+    FULL,
+    // position stream (12 bytes) that depth passes read alone, plus an attribute
+    // stream with a 10:10:10:2 normal and half float uv (8 bytes); no tangent frame
+    COMPACT
+};
+
+// the attribute stream of VertexFormat::COMPACT
+struct CompactAttributes {
+    uint32_t Normal;        // GL_INT_2_10_10_10_REV, normalized
+    uint32_t TexCoords;     // two half floats
+};
+
+// one level of detail: a range of the shared index buffer
+struct MeshLod {
+    unsigned int first;     // first index
+    unsigned int count;     // index count
+    float error;            // bound on the geometric deviation from LOD 0, in model units
+};
+
 struct Texture {
     unsigned int id;
     string type;
@@ -37,31 +68,124 @@ public:
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
+    // the arena's vertex array, shared by every mesh of the same format and index type
     unsigned int VAO;
+    VertexFormat format;
+    // GL_UNSIGNED_SHORT whenever every index fits, GL_UNSIGNED_INT otherwise
+    GLenum indexType;
+    // where the vertices and indices live in the arena, LOD ranges are relative to it
+    MeshArena *arena = nullptr;
+    ArenaRange range;
+    // LOD 0 is the full mesh, every further level has about half the triangles
+    vector<MeshLod> lods;
+    // post-transform cache misses per triangle of LOD 0, as loaded and after optimizeIndices()
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
 
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures,
+         VertexFormat format = VertexFormat::COMPACT, unsigned int lodCount = 1)
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        this->format = format;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(lodCount);
+    }
+
+    const MeshLod &lod(unsigned int level) const
+    {
+        return lods[std::min<size_t>(level, lods.size() - 1)];
+    }
+
+    // byte offset of a level in the arena's index buffer, as glDrawElements wants it
+    const void *lodOffset(unsigned int level) const
+    {
+        return (const void*)(size_t)((range.firstIndex + lod(level).first) * (indexType == GL_UNSIGNED_SHORT ? 2 : 4));
+    }
+
+    // give the arena ranges back; copies of a Mesh share them, so only the owner
+    // (the Model) calls this, once
+    void release()
+    {
+        if(arena)
+            arena->release(range);
+        arena = nullptr;
+    }
+
+    // the arena every mesh of this format and index type is allocated from, created on first use
+    static MeshArena &arenaFor(VertexFormat format, GLenum indexType)
+    {
+        static MeshArena *arenas[2][2] = {};
+        MeshArena *&arena = arenas[format == VertexFormat::FULL][indexType == GL_UNSIGNED_INT];
+        if(!arena)
+        {
+            if(format == VertexFormat::FULL)
+                arena = new MeshArena({sizeof(Vertex)}, indexType, setupFullStream);
+            else
+                arena = new MeshArena({sizeof(glm::vec3), sizeof(CompactAttributes)}, indexType, setupCompactStreams);
+        }
+        return *arena;
     }
 
     // render the mesh
-    void Draw(Shader shader) 
+    void Draw(Shader &shader, unsigned int level = 0) 
     {
         // bind appropriate textures
+        setSamplerUniforms(shader);
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+        
+        // draw mesh
+        glBindVertexArray(VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, lod(level).count, indexType, (void*)lodOffset(level), range.baseVertex);
+        glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // bytes of vertex and index data this mesh keeps on the GPU
+    size_t gpuMemory() const
+    {
+        size_t indexCount = lods.back().first + lods.back().count;
+        return vertices.size() * vertexSize(format) + indexCount * (indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+    }
+
+    static size_t vertexSize(VertexFormat format)
+    {
+        return format == VertexFormat::FULL ? sizeof(Vertex) : sizeof(glm::vec3) + sizeof(CompactAttributes);
+    }
+
+    // point each texture_xxxN sampler at texture unit N-1 of this mesh
+    void setSamplerUniforms(const Shader &shader) const
+    {
+        // sampler locations only change with the program, resolve them once per program
+        if(samplerProgram != shader.ID)
+            resolveSamplers(shader);
+        for(unsigned int i = 0; i < textures.size(); i++)
+            glUniform1i(samplerLocations[i], i);
+    }
+
+private:
+    // cached sampler uniform locations, valid for samplerProgram only
+    mutable unsigned int samplerProgram = 0;
+    mutable vector<GLint> samplerLocations;
+
+    // retrieve the sampler locations (the N in diffuse_textureN) for the given program
+    void resolveSamplers(const Shader &shader) const
+    {
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
+        samplerLocations.clear();
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
             if(name == "texture_diffuse")
@@ -72,45 +196,125 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
              else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
+            samplerLocations.push_back(shader.getLocation(name + number));
+        }
+        samplerProgram = shader.ID;
+    }
 
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    // copies the vertices and indices into the arena of the mesh's format
+    void setupMesh(unsigned int lodCount)
+    {
+        optimizeIndices();
+        vector<unsigned int> lodIndices = buildLods(lodCount);
+        remapVertices(lodIndices);
+
+        vector<glm::vec3> positions;
+        vector<CompactAttributes> attributes;
+        vector<const void*> streams;
+        if(format == VertexFormat::FULL)
+        {
+            // A great thing about structs is that their memory layout is sequential for all its items.
+            streams.push_back(vertices.data());
+        }
+        else
+        {
+            positions.reserve(vertices.size());
+            attributes.reserve(vertices.size());
+            for(const Vertex &vertex : vertices)
+            {
+                positions.push_back(vertex.Position);
+                CompactAttributes packed;
+                packed.Normal = glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(vertex.Normal), 0.0f));
+                packed.TexCoords = glm::packHalf2x16(vertex.TexCoords);
+                attributes.push_back(packed);
+            }
+            streams.push_back(positions.data());
+            streams.push_back(attributes.data());
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        // 16 bit indices halve the index memory of every mesh below 65536 vertices;
+        // with a base vertex they only have to address the mesh's own vertices
+        indexType = vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        arena = &arenaFor(format, indexType);
+        VAO = arena->vertexArray();
+        if(indexType == GL_UNSIGNED_SHORT)
+        {
+            vector<unsigned short> shortIndices(lodIndices.begin(), lodIndices.end());
+            range = arena->allocate(streams, vertices.size(), shortIndices.data(), shortIndices.size());
+        }
+        else
+        {
+            range = arena->allocate(streams, vertices.size(), lodIndices.data(), lodIndices.size());
+        }
     }
 
-private:
-    // render data 
-    unsigned int VBO, EBO;
+    // reorder the triangles for the post-transform cache, then for overdraw
+    void optimizeIndices()
+    {
+        vector<glm::vec3> positions;
+        positions.reserve(vertices.size());
+        for(const Vertex &vertex : vertices)
+            positions.push_back(vertex.Position);
+
+        acmrBefore = computeACMR(indices, vertices.size());
+        indices = optimizeOverdraw(optimizeVertexCache(indices, vertices.size()), positions);
+        acmrAfter = computeACMR(indices, vertices.size());
+    }
 
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    // sort the vertices by first use so fetches walk the buffer forward
+    void remapVertices(vector<unsigned int> &lodIndices)
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        vector<unsigned int> remap;
+        size_t used = vertexFetchRemap(lodIndices, vertices.size(), remap);
+        vector<Vertex> sorted(used);
+        for(size_t i = 0; i < vertices.size(); i++)
+            if(remap[i] != ~0u)
+                sorted[remap[i]] = vertices[i];
+        vertices.swap(sorted);
+        for(unsigned int &index : lodIndices)
+            index = remap[index];
+        for(unsigned int &index : indices)
+            index = remap[index];
+    }
 
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+    // simplify level by level, each from the one before, into one index list
+    vector<unsigned int> buildLods(unsigned int lodCount)
+    {
+        vector<unsigned int> all(indices);
+        lods.clear();
+        lods.push_back(MeshLod{0, (unsigned int) indices.size(), 0.0f});
+        if(lodCount <= 1)
+            return all;
+
+        vector<glm::vec3> positions;
+        positions.reserve(vertices.size());
+        for(const Vertex &vertex : vertices)
+            positions.push_back(vertex.Position);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        vector<unsigned int> previous(indices);
+        float error = 0.0f;
+        for(unsigned int level = 1; level < lodCount; level++)
+        {
+            size_t target = previous.size() / 2 / 3 * 3;
+            float levelError = 0.0f;
+            vector<unsigned int> simplified = simplifyMesh(positions, previous, target, &levelError);
+            // stop once locked seams and borders keep the mesh from shrinking further
+            if(simplified.empty() || simplified.size() > previous.size() * 9 / 10)
+                break;
+            error += levelError;
+            // the next level is simplified from the unordered one, the order only matters for drawing
+            vector<unsigned int> ordered = optimizeVertexCache(simplified, vertices.size());
+            lods.push_back(MeshLod{(unsigned int) all.size(), (unsigned int) ordered.size(), error});
+            all.insert(all.end(), ordered.begin(), ordered.end());
+            previous.swap(simplified);
+        }
+        return all;
+    }
 
+    // attribute layout of the FULL arena: one interleaved stream
+    static void setupFullStream(const vector<GLuint> &streams)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, streams[0]);
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);	
@@ -127,8 +331,22 @@ private:
         // vertex bitangent
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    }
 
-        glBindVertexArray(0);
+    // attribute layout of the COMPACT arena
+    static void setupCompactStreams(const vector<GLuint> &streams)
+    {
+        // stream 0: positions only, all a depth pass ever fetches
+        glBindBuffer(GL_ARRAY_BUFFER, streams[0]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+        // stream 1: normal and uv for the shading passes
+        glBindBuffer(GL_ARRAY_BUFFER, streams[1]);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactAttributes), (void*)offsetof(CompactAttributes, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactAttributes), (void*)offsetof(CompactAttributes, TexCoords));
     }
 };
 #endif
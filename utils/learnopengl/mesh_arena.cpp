@@ -0,0 +1,172 @@
+//
+// Created by light on 10/19/2026.
+//
+#include <learnopengl/mesh_arena.h>
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+// room for the models of a level before the first growth
+static const size_t INITIAL_VERTICES = 1 << 16;
+static const size_t INITIAL_INDICES = 1 << 18;
+
+size_t RangeAllocator::allocate(size_t count) {
+    for (auto it = freeRuns.begin(); it != freeRuns.end(); ++it) {
+        if (it->second < count)
+            continue;
+        size_t offset = it->first;
+        size_t rest = it->second - count;
+        freeRuns.erase(it);
+        if (rest > 0)
+            freeRuns.emplace(offset + count, rest);
+        inUse += count;
+        return offset;
+    }
+    return NONE;
+}
+
+void RangeAllocator::release(size_t offset, size_t count) {
+    if (count == 0)
+        return;
+    inUse -= count;
+    auto next = freeRuns.lower_bound(offset);
+    // merge with the run right after
+    if (next != freeRuns.end() && offset + count == next->first) {
+        count += next->second;
+        next = freeRuns.erase(next);
+    }
+    // and the one right before
+    if (next != freeRuns.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += count;
+            return;
+        }
+    }
+    freeRuns.emplace(offset, count);
+}
+
+void RangeAllocator::grow(size_t capacity) {
+    size_t added = capacity - total;
+    total = capacity;
+    inUse += added;
+    release(capacity - added, added);
+}
+
+MeshArena::MeshArena(const std::vector<GLsizei> &strides, GLenum indexType, Layout layout)
+    : strides(strides), type(indexType), layout(std::move(layout)) {
+    vertexBuffers.resize(strides.size());
+    glGenBuffers((GLsizei) vertexBuffers.size(), vertexBuffers.data());
+    glGenBuffers(1, &indexBuffer);
+    // uploads go through the copy targets, binding GL_ELEMENT_ARRAY_BUFFER would change whatever VAO is bound
+    for (size_t i = 0; i < vertexBuffers.size(); i++) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffers[i]);
+        glBufferData(GL_COPY_WRITE_BUFFER, INITIAL_VERTICES * strides[i], nullptr, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, INITIAL_INDICES * indexSize(), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    vertices.grow(INITIAL_VERTICES);
+    indices.grow(INITIAL_INDICES);
+    createVertexArray();
+}
+
+MeshArena::~MeshArena() {
+    glDeleteVertexArrays((GLsizei) vertexArrays.size(), vertexArrays.data());
+    glDeleteBuffers((GLsizei) vertexBuffers.size(), vertexBuffers.data());
+    glDeleteBuffers(1, &indexBuffer);
+}
+
+GLuint MeshArena::createVertexArray() {
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    setupVertexArray(vao);
+    vertexArrays.push_back(vao);
+    return vao;
+}
+
+void MeshArena::setupVertexArray(GLuint vao) const {
+    glBindVertexArray(vao);
+    layout(vertexBuffers);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GLuint MeshArena::resize(GLuint buffer, size_t oldBytes, size_t newBytes) {
+    GLuint bigger;
+    glGenBuffers(1, &bigger);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    return bigger;
+}
+
+ArenaRange MeshArena::allocate(const std::vector<const void *> &streams, GLuint vertexCount,
+                               const void *indexData, GLuint indexCount) {
+    if (streams.size() != strides.size()) {
+        std::cerr << "ERROR::MESH_ARENA::STREAM_COUNT_MISMATCH" << std::endl;
+        exit(-1);
+    }
+    size_t vertexOffset = vertices.allocate(vertexCount);
+    size_t indexOffset = indices.allocate(indexCount);
+    bool grown = false;
+    while (vertexOffset == RangeAllocator::NONE) {
+        size_t old = vertices.capacity();
+        for (size_t i = 0; i < vertexBuffers.size(); i++)
+            vertexBuffers[i] = resize(vertexBuffers[i], old * strides[i], old * 2 * strides[i]);
+        vertices.grow(old * 2);
+        vertexOffset = vertices.allocate(vertexCount);
+        grown = true;
+    }
+    while (indexOffset == RangeAllocator::NONE) {
+        size_t old = indices.capacity();
+        indexBuffer = resize(indexBuffer, old * indexSize(), old * 2 * indexSize());
+        indices.grow(old * 2);
+        indexOffset = indices.allocate(indexCount);
+        grown = true;
+    }
+    // every vertex array has to follow the buffers it pointed at
+    if (grown)
+        for (GLuint vao : vertexArrays)
+            setupVertexArray(vao);
+
+    for (size_t i = 0; i < vertexBuffers.size(); i++) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffers[i]);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, vertexOffset * strides[i], (GLsizeiptr) vertexCount * strides[i], streams[i]);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset * indexSize(), indexCount * indexSize(), indexData);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    ArenaRange range;
+    range.baseVertex = (GLint) vertexOffset;
+    range.firstIndex = (GLuint) indexOffset;
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+    return range;
+}
+
+void MeshArena::release(const ArenaRange &range) {
+    vertices.release(range.baseVertex, range.vertexCount);
+    indices.release(range.firstIndex, range.indexCount);
+}
+
+size_t MeshArena::usedBytes() const {
+    size_t bytes = indices.used() * indexSize();
+    for (GLsizei stride : strides)
+        bytes += vertices.used() * stride;
+    return bytes;
+}
+
+size_t MeshArena::capacityBytes() const {
+    size_t bytes = indices.capacity() * indexSize();
+    for (GLsizei stride : strides)
+        bytes += vertices.capacity() * stride;
+    return bytes;
+}
@@ -0,0 +1,91 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <vector>
+
+// First-fit allocator over a range of elements, free runs coalesce on release.
+class RangeAllocator {
+public:
+    static const size_t NONE = ~(size_t)0;
+
+    // the start of a free run of count elements, NONE when there is none
+    size_t allocate(size_t count);
+    void release(size_t offset, size_t count);
+    // append elements to the end, free
+    void grow(size_t capacity);
+
+    size_t capacity() const { return total; }
+    size_t used() const { return inUse; }
+
+private:
+    std::map<size_t, size_t> freeRuns;  // offset -> count
+    size_t total = 0;
+    size_t inUse = 0;
+};
+
+// Where a mesh lives in its arena: draw with firstIndex added to the index
+// offset and baseVertex added to every index.
+struct ArenaRange {
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
+    GLuint vertexCount = 0;
+    GLuint indexCount = 0;
+};
+
+// Vertex and index data of many meshes suballocated from a few large buffers
+// sharing one layout, so they all draw from the same vertex array and can be
+// batched with base-vertex or indirect draws. Buffers double (copied on the
+// GPU) when full; ranges released by unloaded meshes are reused.
+class MeshArena {
+public:
+    // called with a vertex array bound and the stream buffers, sets up the attribute pointers
+    using Layout = std::function<void(const std::vector<GLuint> &streams)>;
+
+    // one vertex buffer per stride, indices of indexType (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)
+    MeshArena(const std::vector<GLsizei> &strides, GLenum indexType, Layout layout);
+    ~MeshArena();
+
+    MeshArena(const MeshArena &) = delete;
+    MeshArena &operator=(const MeshArena &) = delete;
+
+    // copy a mesh in, streams[i] holds vertexCount vertices of strides[i] bytes
+    ArenaRange allocate(const std::vector<const void *> &streams, GLuint vertexCount,
+                        const void *indices, GLuint indexCount);
+    void release(const ArenaRange &range);
+
+    // the vertex array every mesh of the arena draws with
+    GLuint vertexArray() const { return vertexArrays[0]; }
+    // another vertex array over the same buffers, for users that add per-instance attributes;
+    // kept pointing at the buffers when they grow
+    GLuint createVertexArray();
+
+    GLenum indexType() const { return type; }
+    size_t indexSize() const { return type == GL_UNSIGNED_SHORT ? 2 : 4; }
+
+    // bytes of the buffers in use by meshes and allocated in total
+    size_t usedBytes() const;
+    size_t capacityBytes() const;
+
+private:
+    std::vector<GLsizei> strides;
+    GLenum type;
+    Layout layout;
+    std::vector<GLuint> vertexBuffers;
+    GLuint indexBuffer = 0;
+    RangeAllocator vertices, indices;
+    std::vector<GLuint> vertexArrays;
+
+    void setupVertexArray(GLuint vao) const;
+    // a bigger copy of a buffer, the old one is deleted
+    static GLuint resize(GLuint buffer, size_t oldBytes, size_t newBytes);
+};
+#endif
@@ -0,0 +1,237 @@
+//
+// Created by light on 10/19/2026.
+//
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <learnopengl/mesh_optimizer.h>
+
+using namespace std;
+
+namespace {
+
+// Forsyth's tuning, the cache is modelled as LRU
+const int CACHE_SIZE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+// smaller clusters sort better but each one starts on a cold cache, and the tail
+// of a cluster cut short by a cold spot never gets to amortise that
+const unsigned int MIN_CLUSTER_TRIANGLES = 64;
+
+float vertexScore(int cachePosition, unsigned int activeTriangles) {
+    if (activeTriangles == 0) return -1.0f;
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // the three vertices of the last triangle score the same, whatever order they went in
+        if (cachePosition < 3) {
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            float scaler = 1.0f / (CACHE_SIZE - 3);
+            score = pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+    // vertices with few triangles left get a boost, so lone triangles are not left behind
+    score += VALENCE_BOOST_SCALE * pow((float) activeTriangles, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+// FIFO cache simulation, returns true on a miss
+struct FifoCache {
+    vector<unsigned int> timestamps;
+    unsigned int time;
+    unsigned int size;
+
+    FifoCache(size_t vertexCount, unsigned int size) : timestamps(vertexCount, 0), time(size + 1), size(size) {}
+
+    bool access(unsigned int vertex) {
+        if (time - timestamps[vertex] > size) {
+            timestamps[vertex] = time++;
+            return true;
+        }
+        return false;
+    }
+
+    void reset() { time += size + 1; }
+};
+
+}
+
+float computeACMR(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize) {
+    if (indices.size() < 3) return 0.0f;
+    FifoCache cache(vertexCount, cacheSize);
+    unsigned int misses = 0;
+    for (unsigned int index : indices)
+        misses += cache.access(index);
+    return (float) misses / (float) (indices.size() / 3);
+}
+
+std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    if (triangleCount == 0) return result;
+
+    // triangles around every vertex, packed into one array
+    vector<unsigned int> activeTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        ++activeTriangles[indices[i]];
+    vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + activeTriangles[v];
+    vector<unsigned int> adjacency(offsets[vertexCount]);
+    vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+        for (int k = 0; k < 3; ++k)
+            adjacency[cursor[indices[t * 3 + k]]++] = (unsigned int) t;
+
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> scores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        scores[v] = vertexScore(-1, activeTriangles[v]);
+    vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+        triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+    vector<bool> emitted(triangleCount, false);
+
+    vector<unsigned int> cache, nextCache;
+    size_t scanStart = 0;
+    size_t best = triangleCount;
+    for (size_t step = 0; step < triangleCount; ++step) {
+        // nothing in the cache is adjacent to a live triangle: take the best of the rest
+        if (best == triangleCount) {
+            float bestScore = -1.0f;
+            for (size_t t = scanStart; t < triangleCount; ++t) {
+                if (emitted[t]) continue;
+                if (best == triangleCount) scanStart = t;
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+
+        emitted[best] = true;
+        const unsigned int *triangle = &indices[best * 3];
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = triangle[k];
+            result.push_back(v);
+            // drop the triangle from the vertex's live list
+            unsigned int *begin = &adjacency[offsets[v]], *end = begin + activeTriangles[v];
+            *std::find(begin, end, (unsigned int) best) = *(end - 1);
+            --activeTriangles[v];
+        }
+
+        // move the triangle to the front of the LRU cache
+        nextCache.assign(triangle, triangle + 3);
+        for (unsigned int v : cache)
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < CACHE_SIZE ? (int) i : -1;
+            scores[v] = vertexScore(cachePosition[v], activeTriangles[v]);
+        }
+
+        // rescore the triangles of everything touched and pick the next one among them
+        best = triangleCount;
+        float bestScore = -1.0f;
+        for (unsigned int v : nextCache) {
+            for (unsigned int i = offsets[v]; i < offsets[v] + activeTriangles[v]; ++i) {
+                unsigned int t = adjacency[i];
+                float score = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+        if (nextCache.size() > CACHE_SIZE) nextCache.resize(CACHE_SIZE);
+        cache.swap(nextCache);
+    }
+    return result;
+}
+
+std::vector<unsigned int> optimizeOverdraw(const std::vector<unsigned int> &indices,
+                                           const std::vector<glm::vec3> &positions, float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) return indices;
+
+    // cut where the cache runs cold anyway, and wherever a cluster started from a cold
+    // cache already does as well as the whole list times threshold
+    float target = computeACMR(indices, positions.size()) * threshold;
+    vector<size_t> clusters;
+    FifoCache cache(positions.size(), 16);
+    unsigned int misses = 0, triangles = 0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        unsigned int triangleMisses = 0;
+        for (int k = 0; k < 3; ++k)
+            triangleMisses += cache.access(indices[t * 3 + k]);
+        if (t == 0 || triangleMisses == 3) {
+            clusters.push_back(t);
+            misses = 0;
+            triangles = 0;
+        }
+        misses += triangleMisses;
+        ++triangles;
+        if (t + 1 < triangleCount && triangles >= MIN_CLUSTER_TRIANGLES && (float) misses / triangles <= target) {
+            clusters.push_back(t + 1);
+            cache.reset();
+            misses = 0;
+            triangles = 0;
+        }
+    }
+    // the soft cut just before a hard one would leave an empty cluster
+    clusters.erase(std::unique(clusters.begin(), clusters.end()), clusters.end());
+    clusters.push_back(triangleCount);
+
+    glm::vec3 meshCenter(0.0f);
+    for (unsigned int index : indices)
+        meshCenter += positions[index];
+    meshCenter /= (float) indices.size();
+
+    // clusters facing outward from the centre go first
+    vector<pair<float, size_t>> order;
+    for (size_t c = 0; c + 1 < clusters.size(); ++c) {
+        glm::vec3 center(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const glm::vec3 &a = positions[indices[t * 3]], &b = positions[indices[t * 3 + 1]],
+                    &p = positions[indices[t * 3 + 2]];
+            glm::vec3 n = glm::cross(b - a, p - a);
+            float triangleArea = glm::length(n);
+            center += (a + b + p) * (triangleArea / 3.0f);
+            normal += n;
+            area += triangleArea;
+        }
+        float key = 0.0f;
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f)
+            key = glm::dot(center / area - meshCenter, normal / normalLength);
+        order.emplace_back(-key, c);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const pair<float, size_t> &a, const pair<float, size_t> &b) { return a.first < b.first; });
+
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (const auto &entry : order) {
+        size_t c = entry.second;
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    }
+    return result;
+}
+
+size_t vertexFetchRemap(const std::vector<unsigned int> &indices, size_t vertexCount,
+                        std::vector<unsigned int> &remap) {
+    remap.assign(vertexCount, ~0u);
+    unsigned int next = 0;
+    for (unsigned int index : indices)
+        if (remap[index] == ~0u)
+            remap[index] = next++;
+    return next;
+}
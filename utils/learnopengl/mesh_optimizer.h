@@ -0,0 +1,35 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Load-time reordering of indexed triangle lists. None of these change the
+// surface, only the order the GPU sees it in.
+
+// Average number of vertex shader invocations per triangle on a FIFO
+// post-transform cache of cacheSize entries. 0.5 is the ideal for a closed
+// grid, 3 is what a cache miss on every corner costs.
+float computeACMR(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Reorders the triangles so consecutive ones share vertices (Forsyth's linear
+// speed vertex cache optimisation).
+std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int> &indices, size_t vertexCount);
+
+// Splits a cache optimised index list into clusters that each keep the ACMR
+// within threshold of the whole list, then draws the clusters facing away from
+// the centre of the mesh first, so the outer surface occludes the rest early.
+std::vector<unsigned int> optimizeOverdraw(const std::vector<unsigned int> &indices,
+                                           const std::vector<glm::vec3> &positions, float threshold = 1.05f);
+
+// New position of every vertex when the buffer is sorted by first use in
+// indices. Unreferenced vertices map to ~0u. Returns the number of vertices kept.
+size_t vertexFetchRemap(const std::vector<unsigned int> &indices, size_t vertexCount,
+                        std::vector<unsigned int> &remap);
+
+#endif
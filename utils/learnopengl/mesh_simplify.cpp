@@ -0,0 +1,194 @@
+//
+// Created by light on 10/19/2026.
+//
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <learnopengl/mesh_simplify.h>
+
+using namespace std;
+
+namespace {
+
+// symmetric 4x4 matrix of a sum of squared plane distances
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+    double planes = 0;
+
+    void addPlane(const glm::vec3 &n, float d) {
+        a2 += n.x * n.x; ab += n.x * n.y; ac += n.x * n.z; ad += n.x * d;
+        b2 += n.y * n.y; bc += n.y * n.z; bd += n.y * d;
+        c2 += n.z * n.z; cd += n.z * d;
+        d2 += (double) d * d;
+        planes += 1;
+    }
+
+    void add(const Quadric &q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        planes += q.planes;
+    }
+
+    // mean squared distance of p to the planes
+    double error(const glm::vec3 &p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                   + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                   + c2 * z * z + 2 * cd * z
+                   + d2;
+        return e > 0 && planes > 0 ? e / planes : 0;
+    }
+};
+
+struct Collapse {
+    double cost;
+    unsigned int from, to;
+
+    bool operator<(const Collapse &other) const { return cost < other.cost; }
+};
+
+glm::vec3 triangleNormal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+    return glm::cross(b - a, c - a);
+}
+
+}
+
+std::vector<unsigned int> simplifyMesh(const std::vector<glm::vec3> &positions,
+                                       const std::vector<unsigned int> &indices,
+                                       size_t targetIndexCount, float *resultError) {
+    vector<unsigned int> result(indices);
+    size_t vertexCount = positions.size();
+    double maxError = 0;
+
+    // weld by position: vertices split for normals or uvs share one topological vertex
+    vector<unsigned int> welded(vertexCount);
+    vector<unsigned int> weldCount(vertexCount, 0);
+    map<tuple<float, float, float>, unsigned int> byPosition;
+    for (unsigned int i = 0; i < vertexCount; ++i) {
+        const glm::vec3 &p = positions[i];
+        auto it = byPosition.emplace(make_tuple(p.x, p.y, p.z), i).first;
+        welded[i] = it->second;
+        ++weldCount[it->second];
+    }
+
+    // seams and open borders are locked, an edge used by a single triangle is a border
+    vector<bool> locked(vertexCount, false);
+    for (unsigned int i = 0; i < vertexCount; ++i)
+        locked[i] = weldCount[welded[i]] > 1;
+    map<pair<unsigned int, unsigned int>, int> edgeUse;
+    for (size_t t = 0; t + 2 < result.size(); t += 3) {
+        for (int e = 0; e < 3; ++e) {
+            unsigned int a = welded[result[t + e]], b = welded[result[t + (e + 1) % 3]];
+            ++edgeUse[make_pair(min(a, b), max(a, b))];
+        }
+    }
+    for (size_t t = 0; t + 2 < result.size(); t += 3) {
+        for (int e = 0; e < 3; ++e) {
+            unsigned int a = result[t + e], b = result[t + (e + 1) % 3];
+            unsigned int wa = welded[a], wb = welded[b];
+            if (edgeUse[make_pair(min(wa, wb), max(wa, wb))] == 1)
+                locked[a] = locked[b] = true;
+        }
+    }
+
+    // every vertex starts with the planes of the triangles around it
+    vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t + 2 < result.size(); t += 3) {
+        const glm::vec3 &a = positions[result[t]], &b = positions[result[t + 1]], &c = positions[result[t + 2]];
+        glm::vec3 n = triangleNormal(a, b, c);
+        float area = glm::length(n);
+        if (area <= 0) continue;
+        n = n / area;
+        float d = -glm::dot(n, a);
+        for (int k = 0; k < 3; ++k)
+            quadrics[result[t + k]].addPlane(n, d);
+    }
+
+    vector<unsigned int> remap(vertexCount);
+    vector<bool> dirty(vertexCount);
+    vector<vector<unsigned int>> vertexTriangles(vertexCount);
+    while (result.size() > targetIndexCount) {
+        // adjacency of the current triangles, rebuilt every pass
+        for (auto &triangles : vertexTriangles) triangles.clear();
+        for (unsigned int t = 0; t + 2 < result.size(); t += 3)
+            for (int k = 0; k < 3; ++k)
+                vertexTriangles[result[t + k]].push_back(t);
+
+        vector<Collapse> collapses;
+        for (unsigned int t = 0; t + 2 < result.size(); t += 3) {
+            for (int e = 0; e < 3; ++e) {
+                unsigned int a = result[t + e], b = result[t + (e + 1) % 3];
+                for (int dir = 0; dir < 2; ++dir) {
+                    unsigned int from = dir ? b : a, to = dir ? a : b;
+                    if (locked[from]) continue;
+                    Quadric q = quadrics[from];
+                    q.add(quadrics[to]);
+                    collapses.push_back(Collapse{q.error(positions[to]), from, to});
+                }
+            }
+        }
+        if (collapses.empty()) break;
+        sort(collapses.begin(), collapses.end());
+
+        // cheapest first; a vertex touched by one collapse waits for the next pass
+        for (unsigned int i = 0; i < vertexCount; ++i) remap[i] = i;
+        fill(dirty.begin(), dirty.end(), false);
+        size_t removable = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        for (const Collapse &collapse : collapses) {
+            if (removed >= removable) break;
+            unsigned int from = collapse.from, to = collapse.to;
+            if (dirty[from] || dirty[to]) continue;
+
+            // reject collapses that would flip a surviving triangle
+            bool flips = false;
+            size_t dropped = 0;
+            for (unsigned int t : vertexTriangles[from]) {
+                unsigned int v0 = result[t], v1 = result[t + 1], v2 = result[t + 2];
+                if (v0 == to || v1 == to || v2 == to) {
+                    ++dropped;
+                    continue;
+                }
+                glm::vec3 before = triangleNormal(positions[v0], positions[v1], positions[v2]);
+                glm::vec3 after = triangleNormal(positions[v0 == from ? to : v0], positions[v1 == from ? to : v1],
+                                                 positions[v2 == from ? to : v2]);
+                if (glm::dot(before, after) <= 0) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips || dropped == 0) continue;
+
+            remap[from] = to;
+            quadrics[to].add(quadrics[from]);
+            maxError = max(maxError, collapse.cost);
+            removed += dropped;
+            for (unsigned int t : vertexTriangles[from])
+                for (int k = 0; k < 3; ++k)
+                    dirty[result[t + k]] = true;
+        }
+        if (removed == 0) break;
+
+        // apply the collapses and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t + 2 < result.size(); t += 3) {
+            unsigned int v0 = remap[result[t]], v1 = remap[result[t + 1]], v2 = remap[result[t + 2]];
+            if (v0 == v1 || v1 == v2 || v0 == v2) continue;
+            result[write++] = v0;
+            result[write++] = v1;
+            result[write++] = v2;
+        }
+        result.resize(write);
+    }
+
+    if (resultError) *resultError = (float) sqrt(maxError);
+    return result;
+}
@@ -0,0 +1,25 @@
+//
+// Created by light on 10/19/2026.
+//
+
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Quadric error edge collapse on an indexed triangle list. Vertices are only
+// ever collapsed onto a neighbour, so the result indexes the same vertex buffer
+// and a whole LOD chain can share it. Vertices on open borders and on attribute
+// seams (several vertices at one position) stay where they are, which keeps the
+// silhouette and the uv layout intact.
+//
+// Returns at most targetIndexCount indices if the mesh allows it. The largest
+// collapse error, the rms distance to the planes it merged in model units, is
+// written to resultError.
+std::vector<unsigned int> simplifyMesh(const std::vector<glm::vec3> &positions,
+                                       const std::vector<unsigned int> &indices,
+                                       size_t targetIndexCount, float *resultError = nullptr);
+
+#endif
@@ -13,7 +13,7 @@
 using namespace std;
 //namespace fs = std::experimental::filesystem;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma) {
+unsigned int TextureFromFile(const char *path, const string &directory, bool /*gamma*/) {
     string normalized_path(path);
     normalized_path.erase(std::unique(normalized_path.begin(), normalized_path.end(), [](char a, char b) {
         return a == '\\' && b == '\\';
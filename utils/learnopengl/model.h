@@ -30,18 +30,88 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    VertexFormat vertexFormat;
+    unsigned int lodCount;
+    // bounding sphere of all meshes, in model units
+    glm::vec3 center;
+    float radius;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // lodCount > 1 simplifies every mesh into a chain of that many levels at load time
+    Model(string const &path, bool gamma = false, VertexFormat format = VertexFormat::COMPACT, unsigned int lodCount = 1)
+        : gammaCorrection(gamma), vertexFormat(format), lodCount(lodCount)
     {
         loadModel(path);
+        computeBounds();
+    }
+
+    // unloading hands the mesh ranges back to their arenas for the next model
+    ~Model()
+    {
+        for(Mesh &mesh : meshes)
+            mesh.release();
+        for(const Texture &texture : textures_loaded)
+            glDeleteTextures(1, &texture.id);
+    }
+
+    Model(const Model &) = delete;
+
+    Model &operator=(const Model &) = delete;
+
+    // the coarsest level whose error stays below maxPixelError on screen, for a model
+    // at the given distance and scale; pixelsPerUnit is the screen size of one unit at distance 1
+    unsigned int selectLod(float distance, float scale, float pixelsPerUnit, float maxPixelError) const
+    {
+        unsigned int levels = 1;
+        for(const Mesh &mesh : meshes)
+            levels = std::max<unsigned int>(levels, mesh.lods.size());
+        for(unsigned int level = levels - 1; level > 0; level--)
+        {
+            float error = 0.0f;
+            for(const Mesh &mesh : meshes)
+                error = std::max(error, mesh.lod(level).error);
+            if(error * scale * pixelsPerUnit <= maxPixelError * distance)
+                return level;
+        }
+        return 0;
+    }
+
+    // bytes of vertex and index data all meshes keep on the GPU
+    size_t gpuMemory() const
+    {
+        size_t bytes = 0;
+        for(const Mesh &mesh : meshes)
+            bytes += mesh.gpuMemory();
+        return bytes;
+    }
+
+    // what the same meshes would take as 56 byte vertices with 32 bit indices
+    size_t fullMemory() const
+    {
+        size_t bytes = 0;
+        for(const Mesh &mesh : meshes)
+            bytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+        return bytes;
+    }
+
+    // post-transform cache misses per triangle over all meshes, as loaded or after optimisation
+    float acmr(bool optimized) const
+    {
+        float misses = 0.0f;
+        size_t triangles = 0;
+        for(const Mesh &mesh : meshes)
+        {
+            misses += (optimized ? mesh.acmrAfter : mesh.acmrBefore) * (mesh.indices.size() / 3);
+            triangles += mesh.indices.size() / 3;
+        }
+        return triangles ? misses / triangles : 0.0f;
     }
 
     // draws the model, and thus all its meshes
-    void Draw(Shader shader)
+    void Draw(Shader &shader, unsigned int level = 0)
     {
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            meshes[i].Draw(shader, level);
     }
     
 private:
@@ -50,7 +120,7 @@ private:
     {
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
@@ -64,6 +134,24 @@ private:
         processNode(scene->mRootNode, scene);
     }
 
+    // a sphere around the bounding box, loose but cheap
+    void computeBounds()
+    {
+        glm::vec3 low(0.0f), high(0.0f);
+        bool first = true;
+        for(const Mesh &mesh : meshes)
+        {
+            for(const Vertex &vertex : mesh.vertices)
+            {
+                low = first ? vertex.Position : glm::min(low, vertex.Position);
+                high = first ? vertex.Position : glm::max(high, vertex.Position);
+                first = false;
+            }
+        }
+        center = (low + high) * 0.5f;
+        radius = glm::length(high - low) * 0.5f;
+    }
+
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
     void processNode(aiNode *node, const aiScene *scene)
     {
@@ -160,7 +248,7 @@ private:
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
         
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(vertices, indices, textures, vertexFormat, lodCount);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -4,168 +4,265 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// Keeps linked programs between runs. Shader asks it before compiling and
+// hands it every program it had to compile; the key is the full source text.
+class ProgramStore
+{
+public:
+    virtual ~ProgramStore() = default;
+    // a linked program for these sources, 0 to compile them
+    virtual GLuint load(const std::string &sources) = 0;
+    // called between attaching the shaders and linking
+    virtual void prepare(GLuint program) = 0;
+    // a freshly linked program and what compiling and linking it cost
+    virtual void save(const std::string &sources, GLuint program, double milliseconds) = 0;
+};
 
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // consulted by every Shader constructed while set, null compiles everything
+    static inline ProgramStore *programStore = nullptr;
+    // constructor generates the shader on the fly, defines are "#define" lines
+    // inserted right after the #version line of every stage
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr,
+           const std::string &defines = "")
     {
         // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
+        std::string vertexCode = readFile(vertexPath);
+        std::string fragmentCode = readFile(fragmentPath);
+        // if geometry shader path is present, also load a geometry shader
         std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+        if(geometryPath != nullptr)
+            geometryCode = readFile(geometryPath);
+        if(!defines.empty())
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
+            insertDefines(vertexCode, defines);
+            insertDefines(fragmentCode, defines);
             if(geometryPath != nullptr)
-            {
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+                insertDefines(geometryCode, defines);
         }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-            exit(-1);
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
+        // 2. compile and link them, or take the program from the store
+        std::vector<Stage> stages = {{GL_VERTEX_SHADER, "VERTEX", vertexCode},
+                                     {GL_FRAGMENT_SHADER, "FRAGMENT", fragmentCode}};
+        std::string sources = vertexCode + "\n//fragment\n" + fragmentCode;
         if(geometryPath != nullptr)
         {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            stages.push_back({GL_GEOMETRY_SHADER, "GEOMETRY", geometryCode});
+            sources += "\n//geometry\n" + geometryCode;
         }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        build(stages, sources);
     }
     // activate the shader
     // ------------------------------------------------------------------------
-    void use() 
+    void use() const
     { 
         glUseProgram(ID); 
     }
+    // look up a uniform location once and remember it, hot paths should keep
+    // the returned handle and use the location overloads below
+    // ------------------------------------------------------------------------
+    GLint getLocation(const std::string &name) const
+    {
+        auto it = uniformLocations.find(name);
+        if(it != uniformLocations.end())
+            return it->second;
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        uniformLocations.emplace(name, location);
+        return location;
+    }
+    // attach a named uniform block to a buffer binding point, if the program uses it
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const char *name, unsigned int binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name);
+        if(index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(getLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(getLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(getLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(getLocation(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(getLocation(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(getLocation(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(getLocation(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(getLocation(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(getLocation(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+    // location overloads, no string handling at all
+    // ------------------------------------------------------------------------
+    void setInt(GLint location, int value) const
+    {
+        glUniform1i(location, value);
+    }
+    void setFloat(GLint location, float value) const
+    {
+        glUniform1f(location, value);
+    }
+    void setVec3(GLint location, const glm::vec3 &value) const
+    {
+        glUniform3fv(location, 1, &value[0]);
+    }
+    void setMat3(GLint location, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(GLint location, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
+
+protected:
+    struct Stage
+    {
+        GLenum type;
+        const char *name;   // for compile errors
+        const std::string &code;
+    };
+
+    // for programs of other stages, which call build() themselves
+    Shader() : ID(0) {}
+
+    // whole file as a string, a missing shader ends the program
+    // ------------------------------------------------------------------------
+    static std::string readFile(const char *path)
+    {
+        std::ifstream file;
+        // ensure ifstream objects can throw exceptions:
+        file.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            file.open(path);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            return stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            exit(-1);
+        }
+    }
+
+    // compile the stages and link them into ID, unless programStore already has a program for sources
+    // ------------------------------------------------------------------------
+    void build(const std::vector<Stage> &stages, const std::string &sources)
+    {
+        // a cached binary of the same sources saves compiling and linking
+        if(programStore)
+        {
+            ID = programStore->load(sources);
+            if(ID)
+                return;
+        }
+        auto compileStart = std::chrono::steady_clock::now();
+        std::vector<unsigned int> shaders;
+        for(const Stage &stage : stages)
+        {
+            const char *code = stage.code.c_str();
+            unsigned int shader = glCreateShader(stage.type);
+            glShaderSource(shader, 1, &code, NULL);
+            glCompileShader(shader);
+            checkCompileErrors(shader, stage.name);
+            shaders.push_back(shader);
+        }
+        // shader Program
+        ID = glCreateProgram();
+        for(unsigned int shader : shaders)
+            glAttachShader(ID, shader);
+        if(programStore)
+            programStore->prepare(ID);
+        glLinkProgram(ID);
+        bool linked = checkCompileErrors(ID, "PROGRAM");
+        // delete the shaders as they're linked into our program now and no longer necessery
+        for(unsigned int shader : shaders)
+            glDeleteShader(shader);
+        if(programStore && linked)
+        {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - compileStart;
+            programStore->save(sources, ID, elapsed.count());
+        }
     }
 
 private:
-    // utility function for checking shader compilation/linking errors.
+    mutable std::unordered_map<std::string, GLint> uniformLocations;
+
+    // #version has to stay the first statement, the defines go on the line after it
+    // and #line keeps compile errors pointing at the lines of the file
+    // ------------------------------------------------------------------------
+    static void insertDefines(std::string &code, const std::string &defines)
+    {
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if(lineEnd == std::string::npos)
+            code = defines + code;
+        else
+            code.insert(lineEnd + 1, defines + "#line 2\n");
+    }
+
+    // utility function for checking shader compilation/linking errors, true when there was none.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -187,6 +284,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif